@@ -0,0 +1,210 @@
+//
+// BATCH.cpp
+//
+// implements the compilation of many programs in one process
+//
+
+#include "batch.hpp"
+
+#include "helpers/thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <streambuf>
+#include <thread>
+
+namespace {
+
+    ///
+    /// \brief collects what is written to a stream per CompilationSession
+    ///
+    /// Writes of threads working for a collected session are kept for it, all other writes go to the stream's
+    /// former buffer. Every write goes straight through, the stream itself does not buffer.
+    ///
+    class SessionOutput final : public streambuf {
+            streambuf*                              passthrough;
+            map<const CompilationSession*, string>& collected;
+            mutex&                                  lock;
+
+            /// \brief get the text collected for the current session, with lock held
+            string* target() {
+                auto text = collected.find(&CompilationSession::current());
+                return text == collected.end() ? nullptr : &text->second;
+            }
+
+        protected:
+            int overflow(int c) override {
+                if (c == traits_type::eof()) { return traits_type::not_eof(c); }
+                lock_guard<mutex> guard(lock);
+                if (string* text = target()) {
+                    text->push_back((char) c);
+                    return c;
+                }
+                return passthrough->sputc((char) c);
+            }
+
+            streamsize xsputn(const char* data, streamsize size) override {
+                lock_guard<mutex> guard(lock);
+                if (string* text = target()) {
+                    text->append(data, size);
+                    return size;
+                }
+                return passthrough->sputn(data, size);
+            }
+
+            int sync() override {
+                lock_guard<mutex> guard(lock);
+                return target() == nullptr ? passthrough->pubsync() : 0;
+            }
+
+        public:
+            SessionOutput(streambuf* passthrough, map<const CompilationSession*, string>& collected, mutex& lock)
+                : passthrough(passthrough), collected(collected), lock(lock) {}
+    };
+
+    ///
+    /// \brief result of a program, kept until the programs before it are printed
+    ///
+    struct Result {
+            int32  code   = EXIT_FAILURE;
+            string output = "";
+    };
+
+} // namespace
+
+optional<vector<string>> batch::readList(const string& path) {
+    ifstream in(path);
+    if (not in) { return nullopt; }
+    vector<string> main_files = {};
+    string         line;
+    while (getline(in, line)) {
+        line.erase(0, line.find_first_not_of(" \t"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (not line.empty() and line[0] != '#') { main_files.push_back(line); }
+    }
+    return main_files;
+}
+
+int32 batch::run(const vector<string>&     main_files,
+                 const CompilationSession& shared,
+                 Compiler                  compiler,
+                 usize                     jobs,
+                 ostream&                  out) {
+    map<const CompilationSession*, string> collected = {};
+    mutex                                  lock;
+    SessionOutput                          collect_out(cout.rdbuf(), collected, lock);
+    SessionOutput                          collect_err(cerr.rdbuf(), collected, lock);
+    streambuf*                             old_out = cout.rdbuf(&collect_out);
+    streambuf*                             old_err = cerr.rdbuf(&collect_err);
+
+    vector<optional<Result>> results = vector<optional<Result>>(main_files.size());
+    usize                    printed = 0; ///< programs whose block was printed, in order
+    usize                    passed  = 0;
+    int32                    worst   = 0;
+    atomic<usize>            next    = 0;
+    mutex                    print_lock;
+
+    auto print = [&](usize i) { // with print_lock held
+        Result& result = *results[i];
+        out << "\e[1m" << main_files[i] << "\e[0m\n" << result.output;
+        if (not result.output.empty() and result.output.back() != '\n') { out << "\n"; }
+        out << (result.code == 0 ? "\e[32mPASSED\e[0m "s : "\e[1;31mFAILED\e[0m "s) << main_files[i]
+            << " (exit code " << result.code << ")\n\n";
+        passed += result.code == 0;
+        worst   = max(worst, result.code);
+    };
+
+    auto work = [&]() {
+        for (usize i = next++; i < main_files.size(); i = next++) {
+            Result result;
+            {
+                CompilationSession session(&shared);
+                {
+                    lock_guard<mutex> guard(lock);
+                    collected[&session] = "";
+                }
+                {
+                    CompilationSession::Scope scope(session);
+                    try {
+                        result.code = compiler(main_files[i]);
+                    } catch (const exception& e) {
+                        cerr << "\e[1;31mERROR:\e[0m internal compiler error: " << e.what() << endl;
+                    }
+                    session.wait(); // jobs left by a failed compilation still print
+                }
+                lock_guard<mutex> guard(lock);
+                result.output = std::move(collected[&session]);
+                collected.erase(&session);
+            }
+            lock_guard<mutex> guard(print_lock);
+            results[i] = std::move(result);
+            while (printed < results.size() and results[printed].has_value()) {
+                print(printed);
+                results[printed++].reset();
+            }
+            out.flush();
+        }
+    };
+
+    // the workers of the ThreadPool preprocess and parse, these threads only wait for them
+    vector<thread> threads = {};
+    usize          count   = min(jobs == 0 ? ThreadPool::shared().size() : jobs, main_files.size());
+    for (usize t = 1; t < count; t++) { threads.emplace_back(work); }
+    work();
+    for (thread& t : threads) { t.join(); }
+
+    cout.rdbuf(old_out);
+    cerr.rdbuf(old_err);
+    out << "\e[36;1mINFO: " << passed << " of " << main_files.size() << " program"
+        << (main_files.size() == 1 ? ""s : "s"s) << " compiled\e[0m" << endl;
+    return worst;
+}
+
+TEST_CASE ("Testing batch::readList", "[batch]") {
+    filesystem::path list = filesystem::temp_directory_path() / "cstc_batch_list.txt";
+    ofstream(list) << "a.cst\n\n# skipped\n  dir/b.cst \r\n";
+    REQUIRE((batch::readList(list.string()) == vector<string> {"a.cst", "dir/b.cst"}));
+    filesystem::remove(list);
+    REQUIRE(not batch::readList(list.string()).has_value());
+}
+
+TEST_CASE ("Testing batch::run", "[batch]") {
+    CompilationSession shared;
+    stringstream       out;
+    vector<string>     main_files = {"a", "b", "c", "d", "e", "f"};
+
+    int32 code = batch::run(
+        main_files,
+        shared,
+        [&](const string& main_file) {
+            cout << "compiling " << main_file << endl;
+            // output of the session's jobs is collected as well
+            CompilationSession::current().submit([main_file]() { cerr << "warning in " << main_file << endl; });
+            CompilationSession::current().wait();
+            if (main_file == "c") { throw runtime_error("broken"); }
+            return main_file == "e" ? 2 : 0;
+        },
+        3,
+        out);
+
+    REQUIRE(code == 2);
+    string expected = "";
+    for (string& main_file : main_files) {
+        expected += "\e[1m" + main_file + "\e[0m\ncompiling " + main_file + "\nwarning in " + main_file + "\n";
+        if (main_file == "c") {
+            expected += "\e[1;31mERROR:\e[0m internal compiler error: broken\n"
+                        "\e[1;31mFAILED\e[0m c (exit code 1)\n\n";
+        } else if (main_file == "e") {
+            expected += "\e[1;31mFAILED\e[0m e (exit code 2)\n\n";
+        } else {
+            expected += "\e[32mPASSED\e[0m " + main_file + " (exit code 0)\n\n";
+        }
+    }
+    expected += "\e[36;1mINFO: 4 of 6 programs compiled\e[0m\n";
+    REQUIRE(out.str() == expected);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+//
+// BATCH.hpp
+//
+// layouts the compilation of many programs in one process
+//
+
+#include "session.hpp"
+#include "snippets.hpp"
+
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+///
+/// \namespace compiles many independent programs in one process, e.g. the test programs of a CI run
+///
+/// Every program is compiled in its own CompilationSession, which shares the modules loaded once up front (lang).
+/// Programs are compiled concurrently. What a compilation prints is collected and shown as one block per program,
+/// in the order the programs were given.
+///
+namespace batch {
+
+    /// \brief read a list of main files: one path per line, empty lines and lines starting with # are skipped.
+    /// Paths are used as they are, relative ones are relative to the working directory
+    ///
+    /// \return nullopt if the list could not be read
+    extern optional<vector<string>> readList(const string& path);
+
+    ///
+    /// \brief compiles a program in the current session
+    ///
+    /// \param main_file main file of the program
+    ///
+    /// \return exit code of the compilation
+    ///
+    using Compiler = function<int32(const string& main_file)>;
+
+    /// \brief compile programs concurrently, each in a new session sharing the modules of another
+    ///
+    /// std::cout and std::cerr of a compilation are collected while it runs. The block of a program is followed by
+    /// a line with its exit code, a summary follows the last one.
+    ///
+    /// \param shared  session holding the shared modules, it must not compile while the batch runs
+    /// \param jobs    number of programs compiled at once, 0 picks the size of the shared ThreadPool
+    /// \param out     stream the blocks and the summary are printed to
+    ///
+    /// \return the highest exit code of the programs
+    extern int32 run(const vector<string>&     main_files,
+                     const CompilationSession& shared,
+                     Compiler                  compiler,
+                     usize                     jobs = 0,
+                     ostream&                  out  = cout);
+
+} // namespace batch
@@ -4,20 +4,23 @@
 #include "../helpers/string_functions.hpp"
 #include "../lexer/token.hpp"
 #include "../module.hpp"
+#include "../session.hpp"
 #include "../snippets.hpp"
 
 #include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 using namespace std;
 
-uint64 parser::errc      = 0;
-uint64 parser::warnc     = 0;
-bool   parser::one_error = false;
-bool   muted             = false;
+thread_local uint64 parser::issued = 0;
+
+/// \brief held while a diagnostic and its notes are shown, modules are preprocessed in parallel
+///
+recursive_mutex diagnostics_lock;
 
 // Register all known compiler error types
 enum {
@@ -86,6 +89,10 @@ map<string, parser::ErrorType> parser::errors = {
     REGISTER_ERROR("Unresolved merge conflict"),
     REGISTER_ERROR("Module not found"),
     REGISTER_ERROR("File not found"),
+    REGISTER_ERROR("Unclosed bracket"),
+    REGISTER_ERROR("Unopened bracket"),
+    REGISTER_ERROR("Mismatched bracket"),
+    REGISTER_ERROR("Circular import"),
 };
 
 #undef LOCAL_COUNTER
@@ -113,16 +120,30 @@ std::map<string, parser::ErrorType> parser::warnings = {
     REGISTER_WARNING("Unclosed multiline comment"),
     REGISTER_WARNING("No implementation file found"),
     REGISTER_WARNING("Import not at top"),
+    REGISTER_WARNING("Integer too big"),
 };
 
 #undef LOCAL_COUNTER
 
 void parser::mute() {
-    muted = true;
+    CompilationSession::current().muted = true;
 }
 
 void parser::unmute() {
-    muted = false;
+    CompilationSession::current().muted = false;
+}
+
+/// \brief split a file name for a diagnostic into the directory, shown dimmed, and the rest, shown bold.
+/// Files of the program directory are shown relative to it, others by their name
+///
+static pair<string, string> splitFileName(const string& filename) {
+    string directory = CompilationSession::current().directory.string() + "/";
+    if (directory.size() > 1 and filename.starts_with(directory)) {
+        return {directory, filename.substr(directory.size())};
+    }
+    usize slash = filename.rfind('/');
+    if (slash == string::npos) { return {"", filename}; }
+    return {filename.substr(0, slash + 1), filename.substr(slash + 1)};
 }
 
 void showError(string             errstr,
@@ -133,54 +154,56 @@ void showError(string             errstr,
                lexer::TokenStream tokens,
                uint32             code,
                string             appendix) {
-    if (muted) { return; }
+    CompilationSession& session = CompilationSession::current();
+    if (session.muted or session.stopped) { return; }
+    lock_guard<recursive_mutex> guard(diagnostics_lock);
     if (tokens.size() == 0) {
         std::cerr << "OH NO! " << errstr << " " << name << " could not be displayed:\n" << msg << "\n";
         return;
     }
     string location;
     if (tokens.size() == 1) {
-        location = ":"s + to_string(tokens[0].line) + ":" + to_string(tokens[0].column);
+        location = ":"s + to_string(tokens[0].line()) + ":" + to_string(tokens[0].column());
     } else {
-        location  = ":"s + to_string(tokens[0].line) + ":" + to_string(tokens[0].column);
-        location += " - " + to_string(tokens[tokens.size() - 1].line) + ":" +
-                    to_string(tokens[tokens.size() - 1].column + tokens[tokens.size() - 1].value.size() - 1);
+        location  = ":"s + to_string(tokens[0].line()) + ":" + to_string(tokens[0].column());
+        location += " - " + to_string(tokens[tokens.size() - 1].line()) + ":" +
+                    to_string(tokens[tokens.size() - 1].column() + tokens[tokens.size() - 1].length - 1);
     }
 
-    std::cerr << "\r" << errcol << errstr << ": " << name << "\e[0m @ \e]8;;file://" << *(tokens[0].filename)
-              << "\e\\\e[0;37m" << Module::directory.string() << "/\e[0m\e[1m"
-              << tokens[0].filename->substr(Module::directory.string().size() + 1) << location << "\e[0m\e]8;;\e\\"
+    auto [directory, file] = splitFileName(tokens[0].filename());
+    std::cerr << "\r" << errcol << errstr << ": " << name << "\e[0m @ \e]8;;file://" << tokens[0].filename()
+              << "\e\\\e[0;37m" << directory << "\e[0m\e[1m" << file << location << "\e[0m\e]8;;\e\\"
               << (code == 0 ? ""s : " ["s + errstr[0] + to_string(code) + "]") << ":" << std::endl;
     std::cerr << "\e[0m" << msg << "\e[0m" << std::endl;
     std::cerr << "       | " << std::endl;
     if (tokens.size() == 1) {
-        std::cerr << " " << fillup(to_string(tokens[0].line), 5) << " | " << *(tokens[0].line_contents) << std::endl;
-        std::cerr << "       | " << errcol_lite << fillup("", tokens[0].column - 1)
-                  << fillup("", tokens[0].value.size(), '^') << "\e[0m" << std::endl;
+        std::cerr << " " << fillup(to_string(tokens[0].line()), 5) << " | " << tokens[0].lineContents() << std::endl;
+        std::cerr << "       | " << errcol_lite << fillup("", tokens[0].column() - 1)
+                  << fillup("", tokens[0].length, '^') << "\e[0m" << std::endl;
     } else {
-        std::cerr << " " << fillup(to_string(tokens[0].line), 5) << " | " << (*(tokens[0].line_contents)) << std::endl;
-        if (tokens[0].line == tokens[tokens.size() - 1].line) {
-            std::cerr << "       | " << errcol_lite << fillup("", tokens[0].column - 1)
+        std::cerr << " " << fillup(to_string(tokens[0].line()), 5) << " | " << tokens[0].lineContents() << std::endl;
+        if (tokens[0].line() == tokens[tokens.size() - 1].line()) {
+            std::cerr << "       | " << errcol_lite << fillup("", tokens[0].column() - 1)
                       << fillup("",
-                                tokens[tokens.size() - 1].column - (tokens[0].column) +
-                                    tokens[tokens.size() - 1].value.size(),
+                                tokens[tokens.size() - 1].column() - (tokens[0].column()) +
+                                    tokens[tokens.size() - 1].length,
                                 '^')
                       << "\e[0m" << std::endl;
         } else {
-            std::cerr << "       | " << errcol_lite << fillup("", tokens[0].column - 1)
-                      << fillup("", (*(tokens[0].line_contents)).size() - (tokens[0].column - 1) - 1, '^') << "\e[0m"
+            std::cerr << "       | " << errcol_lite << fillup("", tokens[0].column() - 1)
+                      << fillup("", tokens[0].lineContents().size() - (tokens[0].column() - 1) - 1, '^') << "\e[0m"
                       << std::endl;
-            if (tokens[tokens.size() - 1].line - tokens[0].line > 1) {
+            if (tokens[tokens.size() - 1].line() - tokens[0].line() > 1) {
                 std::cerr << "       | \t" << errcol_lite << "("
-                          << to_string(tokens[tokens.size() - 1].line - tokens[0].line - 1) << " line"
-                          << (tokens[tokens.size() - 1].line - tokens[0].line - 1 == 1 ? "" : "s") << " hidden)\e[0m"
+                          << to_string(tokens[tokens.size() - 1].line() - tokens[0].line() - 1) << " line"
+                          << (tokens[tokens.size() - 1].line() - tokens[0].line() - 1 == 1 ? "" : "s") << " hidden)\e[0m"
                           << std::endl;
             }
 
-            std::cerr << " " << fillup(to_string(tokens[tokens.size() - 1].line), 5) << " | "
-                      << *(tokens[tokens.size() - 1].line_contents) << std::endl;
+            std::cerr << " " << fillup(to_string(tokens[tokens.size() - 1].line()), 5) << " | "
+                      << tokens[tokens.size() - 1].lineContents() << std::endl;
             std::cerr << "       | " << errcol_lite
-                      << fillup("", tokens[tokens.size() - 1].column + tokens[tokens.size() - 1].value.size() - 1, '^')
+                      << fillup("", tokens[tokens.size() - 1].column() + tokens[tokens.size() - 1].length - 1, '^')
                       << "\e[0m" << std::endl;
         }
     }
@@ -188,58 +211,70 @@ void showError(string             errstr,
     std::cerr << appendix << std::endl;
 }
 
+/// \brief split tokens into runs that share the same included source
+///
 vector<lexer::TokenStream> splitIncluded(lexer::TokenStream tokens) {
     if (tokens.empty()) { return {}; }
-    vector<lexer::TokenStream> out          = {};
-    usize                      i            = 0;
-    usize                      start        = 0;
-    sptr<lexer::TokenStream>   last_include = tokens[0].include;
+    vector<lexer::TokenStream> out         = {};
+    usize                      i           = 0;
+    usize                      start       = 0;
+    const lexer::Source*       last_source = tokens[0].source;
 
     while (i < tokens.size()) {
-        while (i < tokens.size() and (tokens[i].include) == last_include) { i++; }
-        if (last_include != nullptr and start != i) {
-            if (start != i) { out.push_back(tokens.slice(start, i)); }
+        while (i < tokens.size() and tokens[i].source == last_source) { i++; }
+        if (last_source != nullptr and last_source->included_from != nullptr and start != i) {
+            out.push_back(tokens.slice(start, i));
         }
         start = i;
-        if (i < tokens.size()) { last_include = tokens[i].include; }
-    }
-    if (last_include != nullptr and start != i) {
-        if (start != i) { out.push_back(tokens.slice(start, i)); }
+        if (i < tokens.size()) { last_source = tokens[i].source; }
     }
     return out;
 }
 
-// TODO
 void noteIncludeMacro(lexer::TokenStream tokens) {
     vector<lexer::TokenStream> includes = splitIncluded(tokens);
-    for (lexer::TokenStream t : includes) { parser::note(*t[0].include, "included from file: " + *t[0].filename); }
+    for (lexer::TokenStream t : includes) {
+        parser::note(*t[0].source->included_from, "included from file: " + t[0].filename());
+    }
 }
 
 void parser::error(ErrorType type, lexer::TokenStream tokens, string msg, string appendix) {
+    lock_guard<recursive_mutex> guard(diagnostics_lock);
+    CompilationSession& session = CompilationSession::current();
+    issued++;
+    if (session.stopped) { return; }
     showError("ERROR", "\e[1;31m", "\e[31m", type.name, msg, tokens, type.code, appendix);
     noteIncludeMacro(tokens);
-    errc++;
-    if (one_error) { std::exit(3); }
+    session.errc++;
+    // the compiler stops on its main thread, exiting here would end the process from a worker
+    session.stopped = session.one_error;
 }
 
 void parser::error(ErrorType type, vector<lexer::Token> tokens, string msg, string appendix) {
+    lock_guard<recursive_mutex> guard(diagnostics_lock);
+    CompilationSession& session = CompilationSession::current();
+    issued++;
+    if (session.stopped) { return; }
     showError("ERROR",
               "\e[1;31m",
               "\e[31m",
               type.name,
               msg,
-              lexer::TokenStream(make_shared<vector<lexer::Token>>(tokens)),
+              lexer::TokenStream(tokens),
               type.code,
               appendix);
-    noteIncludeMacro(lexer::TokenStream(make_shared<vector<lexer::Token>>(tokens)));
-    errc++;
-    if (one_error) { std::exit(3); }
+    noteIncludeMacro(lexer::TokenStream(tokens));
+    session.errc++;
+    // the compiler stops on its main thread, exiting here would end the process from a worker
+    session.stopped = session.one_error;
 }
 
 void parser::warn(ErrorType type, lexer::TokenStream tokens, string msg, string appendix) {
+    lock_guard<recursive_mutex> guard(diagnostics_lock);
     showError("WARNING", "\e[1;33m", "\e[33m", type.name, msg, tokens, type.code, appendix);
     noteIncludeMacro(tokens);
-    warnc++;
+    CompilationSession::current().warnc++;
+    issued++;
 }
 
 void parser::note(lexer::TokenStream tokens, string msg, string appendix) {
@@ -252,22 +287,24 @@ void parser::note(vector<lexer::Token> tokens, string msg, string appendix) {
               "\e[36m",
               "",
               msg,
-              lexer::TokenStream(make_shared<vector<lexer::Token>>(tokens)),
+              lexer::TokenStream(tokens),
               0,
               appendix);
 }
 
 void parser::warn(parser::ErrorType type, vector<lexer::Token> tokens, string msg, string appendix) {
+    lock_guard<recursive_mutex> guard(diagnostics_lock);
     showError("WARNING",
               "\e[1;33m",
               "\e[33m",
               type.name,
               msg,
-              lexer::TokenStream(make_shared<vector<lexer::Token>>(tokens)),
+              lexer::TokenStream(tokens),
               type.code,
               appendix);
-    noteIncludeMacro(lexer::TokenStream(make_shared<vector<lexer::Token>>(tokens)));
-    warnc++;
+    noteIncludeMacro(lexer::TokenStream(tokens));
+    CompilationSession::current().warnc++;
+    issued++;
 }
 
 parser::HelpBuffer::HelpBuffer(string s) {
@@ -335,7 +372,7 @@ string parser::HelpBuffer::_str() const {
     if (type == STRING) {
         out += "s:" + s;
     } else if (type == TOKEN) {
-        out += "t:" + t.value;
+        out += "t:" + string(t.value());
     } else if (type == TOKEN_STREAM) {
         lexer::TokenStream t  = st;
         out                  += "st:" + str(t);
@@ -399,17 +436,17 @@ void parser::help(HelpBuffer buf, string msg, string appendix) {
         }
         if (p->type == HelpBuffer::TOKEN) {
             if (filename == "") {
-                filename   = *(p->t.filename);
-                line_start = current_line = p->t.line;
-                column_start              = p->t.column;
-                lines.at(0).prefix        = p->t.line_contents->substr(0, p->t.column - 1);
+                filename   = p->t.filename();
+                line_start = current_line = p->t.line();
+                column_start              = p->t.column();
+                lines.at(0).prefix        = string(p->t.lineContents().substr(0, p->t.column() - 1));
                 lines.at(0).line          = line_start;
                 handleHelpBufferString(0)
             }
-            if (p->t.line + line_offset != current_line) {
-                current_line = p->t.line + line_offset;
+            if (p->t.line() + line_offset != current_line) {
+                current_line = p->t.line() + line_offset;
 
-                lines.push_back({p->t.line + line_offset, p->t.line_contents->substr(0, p->t.column - 1), {}, ""});
+                lines.push_back({p->t.line() + line_offset, string(p->t.lineContents().substr(0, p->t.column() - 1)), {}, ""});
                 handleHelpBufferString(lines.size() - 1);
             }
             lines.at(lines.size() - 1).contents.push_back(*p);
@@ -417,17 +454,17 @@ void parser::help(HelpBuffer buf, string msg, string appendix) {
         if (p->type == HelpBuffer::TOKEN_STREAM) {
             for (lexer::Token t : *(p->st.tokens)) {
                 if (filename == "") {
-                    filename   = *t.filename;
-                    line_start = current_line = t.line;
-                    column_start              = t.column;
-                    lines.at(0).prefix        = t.line_contents->substr(0, t.column - 1);
+                    filename   = t.filename();
+                    line_start = current_line = t.line();
+                    column_start              = t.column();
+                    lines.at(0).prefix        = string(t.lineContents().substr(0, t.column() - 1));
                     lines.at(0).line          = line_start;
                     handleHelpBufferString(0)
                 }
-                if (t.line + line_offset != current_line) {
-                    current_line = t.line + line_offset;
+                if (t.line() + line_offset != current_line) {
+                    current_line = t.line() + line_offset;
 
-                    lines.push_back({t.line + line_offset, t.line_contents->substr(0, t.column - 1), {}, ""});
+                    lines.push_back({t.line() + line_offset, string(t.lineContents().substr(0, t.column() - 1)), {}, ""});
                     handleHelpBufferString(lines.size() - 1);
                 }
                 lines.at(lines.size() - 1).contents.push_back(t);
@@ -436,9 +473,9 @@ void parser::help(HelpBuffer buf, string msg, string appendix) {
         p = p->next.get();
     }
 
-    cerr << "\e[1;32mHELP:\e[0m @ \e]8;;file://" << filename << "\e\\\e[0;37m" << Module::directory.string()
-         << "/\e[0m\e[1m" << filename.substr(Module::directory.string().size() + 1) << ":" << line_start << ":"
-         << column_start << "\e[0m\e]8;;\e\\" << endl;
+    auto [directory, file] = splitFileName(filename);
+    cerr << "\e[1;32mHELP:\e[0m @ \e]8;;file://" << filename << "\e\\\e[0;37m" << directory << "\e[0m\e[1m" << file
+         << ":" << line_start << ":" << column_start << "\e[0m\e]8;;\e\\" << endl;
     cerr << msg << endl;
     cerr << "       | " << endl;
 
@@ -459,9 +496,9 @@ void parser::help(HelpBuffer buf, string msg, string appendix) {
                     }
                 case parser::HelpBuffer::TOKEN :
                     {
-                        if (last_type != HelpBuffer::STRING) { cerr << fillup("", h.t.column - last_column); }
-                        cerr << h.t.value;
-                        last_column = h.t.column + h.t.value.size();
+                        if (last_type != HelpBuffer::STRING) { cerr << fillup("", h.t.column() - last_column); }
+                        cerr << h.t.value();
+                        last_column = h.t.column() + h.t.length;
                         break;
                     }
             }
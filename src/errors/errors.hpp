@@ -11,9 +11,9 @@ using namespace std;
 
 namespace parser {
 
-    extern uint64 errc;      ///< amount of raised errors
-    extern uint64 warnc;     ///< amount raised warnings
-    extern bool   one_error; ///< whether the "one error mode" (compiler exit on first error) is enabled
+    // errors and warnings are counted in the CompilationSession of the issuing thread, \see CompilationSession::errc
+
+    extern thread_local uint64 issued; ///< errors and warnings raised on this thread
 
     /// \brief structure representing a type of error
     ///
@@ -25,11 +25,11 @@ namespace parser {
     extern map<string, ErrorType> errors;   ///< all ErrorType's for errors are stored here
     extern map<string, ErrorType> warnings; ///< all ErrorType's for warnings are stored here
 
-    /// \brief mute all error output until unmuted. used mainly for tests.
+    /// \brief mute all error output of the current session until unmuted. used mainly for tests.
     ///
     extern void mute();
 
-    /// \brief unmute all error output. used mainly for tests.
+    /// \brief unmute all error output of the current session. used mainly for tests.
     ///
     extern void unmute();
 
@@ -0,0 +1,188 @@
+//
+// GRAPH.cpp
+//
+// implements the export of the module graph
+//
+
+#include "graph.hpp"
+
+#include "helpers/stat_cache.hpp"
+#include "module.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+
+namespace {
+
+    /// \brief quote a string for JSON and DOT
+    string quote(const string& text) {
+        ostringstream out;
+        out << '"';
+        for (char c : text) {
+            if (c == '"' or c == '\\') {
+                out << '\\' << c;
+            } else if (c == '\n') {
+                out << "\\n";
+            } else if ((unsigned char) c < 0x20) {
+                out << "\\u" << hex << setw(4) << setfill('0') << (int32) c << dec;
+            } else {
+                out << c;
+            }
+        }
+        out << '"';
+        return out.str();
+    }
+
+    /// \brief get the cost of a module in seconds
+    float64 cost(const Module* m) {
+        return m->stats.lex + m->stats.preprocess + m->stats.parse;
+    }
+
+    /// \brief format seconds as milliseconds
+    string ms(float64 seconds) {
+        ostringstream out;
+        out << fixed << setprecision(3) << seconds * 1000;
+        return out.str();
+    }
+
+} // namespace
+
+optional<graph::Format> graph::parseFormat(const string& name) {
+    if (name == "json") { return Format::JSON; }
+    if (name == "dot") { return Format::DOT; }
+    return nullopt;
+}
+
+string graph::extension(Format format) {
+    return format == Format::JSON ? "json" : "dot";
+}
+
+vector<Module*> graph::criticalPath(const list<Module*>& modules) {
+    map<Module*, float64> finish = {}; ///< cost of the most expensive chain ending in a module
+    map<Module*, Module*> before = {}; ///< dependency the most expensive chain comes from
+    Module*               last   = nullptr;
+    for (Module* m : modules) {
+        finish[m] = 0;
+        before[m] = nullptr;
+        for (Module* dep : m->dependencies()) {
+            if (finish.count(dep) == 0) { continue; } // built in a shared session
+            if (before[m] == nullptr or finish[dep] > finish[before[m]]) { before[m] = dep; }
+        }
+        finish[m] = cost(m) + (before[m] == nullptr ? 0 : finish[before[m]]);
+        if (last == nullptr or finish[m] > finish[last]) { last = m; }
+    }
+    vector<Module*> path = {};
+    for (Module* m = last; m != nullptr; m = before[m]) { path.push_back(m); }
+    reverse(path.begin(), path.end());
+    return path;
+}
+
+void graph::write(ostream& out, const list<Module*>& modules, Format format) {
+    // shared modules are only imported, they come first as they were built first
+    vector<Module*> nodes    = {};
+    set<Module*>    built    = set<Module*>(modules.begin(), modules.end());
+    set<Module*>    imported = {};
+    for (Module* m : modules) {
+        for (Module* dep : m->dependencies()) {
+            if (built.count(dep) == 0 and imported.insert(dep).second) { nodes.push_back(dep); }
+        }
+    }
+    nodes.insert(nodes.end(), modules.begin(), modules.end());
+
+    vector<Module*> path     = criticalPath(modules);
+    set<Module*>    critical = set<Module*>(path.begin(), path.end());
+    float64         total    = 0;
+    for (Module* m : path) { total += cost(m); }
+
+    if (format == Format::JSON) {
+        out << "{\n  \"modules\": [";
+        for (usize i = 0; i < nodes.size(); i++) {
+            Module* m = nodes[i];
+            out << (i == 0 ? "\n" : ",\n") << "    {\"name\": " << quote(m->module_name)
+                << ", \"file\": " << quote(m->cst_file.string()) << ", \"shared\": " << boolalpha
+                << (imported.count(m) > 0) << ", \"lex_ms\": " << ms(m->stats.lex)
+                << ", \"preprocess_ms\": " << ms(m->stats.preprocess) << ", \"parse_ms\": " << ms(m->stats.parse)
+                << ", \"tokens\": " << m->stats.tokens << ", \"bytes\": " << m->stats.bytes << ", \"imports\": [";
+            vector<Module*> deps = m->dependencies();
+            for (usize d = 0; d < deps.size(); d++) { out << (d == 0 ? "" : ", ") << quote(deps[d]->module_name); }
+            out << "]}";
+        }
+        out << "\n  ],\n  \"critical_path\": {\"modules\": [";
+        for (usize i = 0; i < path.size(); i++) { out << (i == 0 ? "" : ", ") << quote(path[i]->module_name); }
+        out << "], \"ms\": " << ms(total) << "}\n}\n";
+        return;
+    }
+
+    out << "digraph modules {\n"
+        << "    label=" << quote("critical path: " + ms(total) + " ms") << ";\n"
+        << "    node [shape=box];\n";
+    for (Module* m : nodes) {
+        string label = m->module_name + "\nlex " + ms(m->stats.lex) + " ms, preprocess " + ms(m->stats.preprocess) +
+                       " ms, parse " + ms(m->stats.parse) + " ms\n" + to_string(m->stats.tokens) + " tokens, " +
+                       to_string(m->stats.bytes) + " bytes";
+        out << "    " << quote(m->module_name) << " [label=" << quote(label)
+            << (critical.count(m) > 0 ? ", color=red" : imported.count(m) > 0 ? ", style=dashed" : "") << "];\n";
+    }
+    for (usize i = 0; i < nodes.size(); i++) {
+        for (Module* dep : nodes[i]->dependencies()) {
+            // an edge of the critical path links neighbours on it
+            auto on_path = find(path.begin(), path.end(), dep);
+            bool red     = on_path != path.end() and next(on_path) != path.end() and *next(on_path) == nodes[i];
+            out << "    " << quote(nodes[i]->module_name) << " -> " << quote(dep->module_name)
+                << (red ? " [color=red]" : "") << ";\n";
+        }
+    }
+    out << "}\n";
+}
+
+TEST_CASE ("Testing the module graph", "[modules]") {
+    fs::path dir = fs::temp_directory_path() / "cstc_graph_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    ofstream(dir / "a.cst") << "import b;\nimport c;\n";
+    ofstream(dir / "b.cst") << "import d;\n";
+    ofstream(dir / "c.cst") << "import d;\n";
+    ofstream(dir / "d.cst") << "y = 1;\n";
+    stat_cache.clear();
+
+    CompilationSession        session;
+    CompilationSession::Scope scope(session);
+    Module* a = Module::create("a", "", (dir / "main.cst").string(), false, lexer::TokenStream::none(), true);
+    Module::awaitFetched();
+    for (vector<Module*>& level : Module::buildLevels()) {
+        for (Module* m : level) { m->parse(); }
+    }
+
+    string prefix = a->module_name.substr(0, a->module_name.size() - 1);
+    auto   module = [&](string name) { return session.known_modules.at(prefix + name); };
+    REQUIRE(module("d")->stats.tokens == 4);
+    REQUIRE(module("d")->stats.bytes == 7);
+
+    // the chain through the most expensive module is the critical one, whatever was measured
+    for (Module* m : session.modules) { m->stats = {0, 0, 0.001, m->stats.tokens, m->stats.bytes}; }
+    module("c")->stats.parse = 0.005;
+    REQUIRE((graph::criticalPath(session.modules) == vector<Module*> {module("d"), module("c"), a}));
+
+    stringstream json;
+    graph::write(json, session.modules, graph::Format::JSON);
+    REQUIRE(json.str().find("\"critical_path\": {\"modules\": [" + quote(module("d")->module_name) + ", " +
+                            quote(module("c")->module_name) + ", " + quote(a->module_name) + "], \"ms\": 7.000}") !=
+            string::npos);
+    REQUIRE(json.str().find("\"tokens\": 4, \"bytes\": 7, \"imports\": []}") != string::npos);
+
+    stringstream dot;
+    graph::write(dot, session.modules, graph::Format::DOT);
+    REQUIRE(dot.str().starts_with("digraph modules {\n    label=\"critical path: 7.000 ms\";\n"));
+    REQUIRE(dot.str().find(quote(a->module_name) + " -> " + quote(module("c")->module_name) + " [color=red];") !=
+            string::npos);
+    REQUIRE(dot.str().find(quote(a->module_name) + " -> " + quote(module("b")->module_name) + ";") != string::npos);
+
+    REQUIRE(graph::parseFormat("dot") == graph::Format::DOT);
+    REQUIRE(not graph::parseFormat("svg").has_value());
+    fs::remove_all(dir);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+//
+// GRAPH.hpp
+//
+// layouts the export of the module graph
+//
+
+#include "snippets.hpp"
+
+#include <list>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class Module;
+
+///
+/// \namespace exports the import graph of a compilation with what each module took, to find the chains of modules
+/// that keep the build from running in parallel
+///
+/// A module depends on the modules it imports and on the modules it includes (lang). The cost of a module is the time
+/// spent lexing, preprocessing and parsing it. The critical path is the chain of dependencies with the highest total
+/// cost: the build can not be faster than it, no matter how many threads it uses.
+///
+namespace graph {
+
+    ///
+    /// \brief file formats of the graph
+    ///
+    enum class Format {
+        JSON, ///< modules with their measurements, imports and the critical path
+        DOT,  ///< Graphviz, the critical path is drawn in red
+    };
+
+    /// \brief get a format by its name, "json" or "dot"
+    ///
+    /// \return nullopt if there is no such format
+    extern optional<Format> parseFormat(const string& name);
+
+    /// \brief get the file extension of a format, without the dot
+    extern string extension(Format format);
+
+    /// \brief get the critical path through the modules
+    ///
+    /// \param modules modules in build order, as sorted by Module::buildLevels()
+    ///
+    /// \return modules of the path, a module before the modules depending on it. Empty if there are no modules
+    extern vector<Module*> criticalPath(const list<Module*>& modules);
+
+    /// \brief write the graph of the modules
+    ///
+    /// Modules of a shared session that are imported are part of the graph, but not of the critical path.
+    ///
+    /// \param modules modules in build order, as sorted by Module::buildLevels()
+    extern void write(ostream& out, const list<Module*>& modules, Format format);
+
+} // namespace graph
@@ -0,0 +1,111 @@
+#include "build_db.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <unistd.h>
+
+// text format: "cstc-build <version>", then per module
+// <name> <content hash> <interface hash> <dependency count>, followed by <name> <interface hash> per dependency
+BuildDatabase::BuildDatabase(const string& directory) : path(directory + "/" + file_name) {
+    ifstream in(path);
+    string   magic;
+    uint32   file_version = 0;
+    if (not(in >> magic >> file_version) or magic != "cstc-build" or file_version != version) { return; }
+
+    map<string, Record> records = {};
+    string              name;
+    while (in >> quoted(name)) {
+        Record record;
+        usize  dependency_count = 0;
+        if (not(in >> hex >> record.content_hash >> record.interface_hash >> dec >> dependency_count)) { return; }
+        for (usize d = 0; d < dependency_count; d++) {
+            pair<string, uint64> dependency;
+            if (not(in >> quoted(dependency.first) >> hex >> dependency.second >> dec)) { return; }
+            record.dependencies.push_back(std::move(dependency));
+        }
+        records[name] = std::move(record);
+    }
+    if (in.eof()) { previous = std::move(records); } // a truncated database is not trusted at all
+}
+
+optional<BuildDatabase::Record> BuildDatabase::find(const string& module_name) const {
+    auto record = previous.find(module_name);
+    if (record == previous.end()) { return nullopt; }
+    return record->second;
+}
+
+void BuildDatabase::record(const string& module_name, Record record) {
+    lock_guard<mutex> guard(lock);
+    current[module_name] = std::move(record);
+}
+
+bool BuildDatabase::save() const {
+    lock_guard<mutex> guard(lock);
+    string            temporary = path + "." + to_string(getpid());
+    {
+        ofstream out(temporary);
+        out << "cstc-build " << version << "\n";
+        for (auto& [name, record] : current) {
+            out << quoted(name) << " " << hex << record.content_hash << " " << record.interface_hash << " " << dec
+                << record.dependencies.size() << "\n";
+            for (auto& [dependency, interface_hash] : record.dependencies) {
+                out << "  " << quoted(dependency) << " " << hex << interface_hash << dec << "\n";
+            }
+        }
+        if (not out.flush()) {
+            out.close();
+            unlink(temporary.c_str());
+            return false;
+        }
+    }
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+void BuildDatabase::commit() {
+    lock_guard<mutex> guard(lock);
+    previous = std::move(current);
+    current  = {};
+}
+
+TEST_CASE ("Testing BuildDatabase", "[helpers]") {
+    filesystem::path dir = filesystem::temp_directory_path() / "cstc_build_db_test";
+    filesystem::remove_all(dir);
+    filesystem::create_directories(dir);
+
+    {
+        BuildDatabase database(dir.string());
+        REQUIRE(not database.find("main").has_value());
+        database.record("main", {1, 0xffffffffffffffff, {{"lang", 3}, {"my module", 4}}});
+        database.record("lang", {5, 6, {}});
+        REQUIRE(not database.find("main").has_value()); // only records of the last build are found
+        REQUIRE(database.save());
+    }
+
+    BuildDatabase database(dir.string());
+    optional<BuildDatabase::Record> record = database.find("main");
+    REQUIRE(record.has_value());
+    REQUIRE(record->content_hash == 1);
+    REQUIRE(record->interface_hash == 0xffffffffffffffff);
+    REQUIRE((record->dependencies == vector<pair<string, uint64>> {{"lang", 3}, {"my module", 4}}));
+    REQUIRE(database.find("lang")->interface_hash == 6);
+
+    // modules not recorded again are dropped
+    database.record("lang", {5, 6, {}});
+    REQUIRE(database.save());
+    REQUIRE(not BuildDatabase(dir.string()).find("main").has_value());
+    database.commit();
+    REQUIRE(not database.find("main").has_value());
+    REQUIRE(database.find("lang").has_value());
+
+    // a damaged database is ignored
+    ofstream(dir / BuildDatabase::file_name) << "cstc-build 1\nlang 5 6 2\n";
+    REQUIRE(not BuildDatabase(dir.string()).find("lang").has_value());
+
+    filesystem::remove_all(dir);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "../snippets.hpp"
+
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+///
+/// \brief the modules of the last build in a project, used by incremental builds to skip unchanged modules
+///
+/// Every module is recorded with a hash of its sources, a hash of its interface (the symbols other modules see)
+/// and the interfaces of the modules it depended on. A module is built again if its sources changed
+/// or one of these interfaces did, so a change to an implementation does not rebuild its dependents.
+/// The database is read once when opened and replaced as a whole by save(), modules not recorded again are dropped.
+/// A compiler that stays resident keeps the database open and commits it after every build.
+///
+class BuildDatabase final {
+    public:
+        ///
+        /// \brief a module as it was built
+        ///
+        struct Record {
+                uint64                       content_hash   = 0;  ///< hash of the module's sources
+                uint64                       interface_hash = 0;  ///< hash of the module's exported symbols
+                vector<pair<string, uint64>> dependencies   = {}; ///< modules it depended on, with their interface hash
+        };
+
+        static constexpr const char* file_name = ".cstc-build"; ///< name of the database in the project directory
+        static constexpr uint32      version   = 1;             ///< increase whenever the hashes or the format change
+
+    private:
+        string              path     = ""; ///< database file
+        map<string, Record> previous = {}; ///< records of the last build
+        map<string, Record> current  = {}; ///< records of this build
+        mutable mutex       lock;
+
+    public:
+        /// \brief open the database of a project directory, missing or unreadable databases are empty
+        explicit BuildDatabase(const string& directory);
+
+        /// \brief look up a module of the last build
+        optional<Record> find(const string& module_name) const;
+
+        /// \brief record a module of this build
+        void record(const string& module_name, Record record);
+
+        /// \brief replace the database by the records of this build
+        ///
+        /// \return false if it could not be written
+        bool save() const;
+
+        /// \brief make the records of this build the last build, for another build in the same process
+        void commit();
+};
@@ -13,11 +13,11 @@ class CstType : public string {
     public:
         /// \brief create a CstType
         ///
-        CstType() { CstType(""); }
+        CstType() : string("") {}
 
         /// \brief create a CstType
         ///
-        CstType(string s) { *this = s; }
+        CstType(string s) : string(std::move(s)) {}
 
         bool operator==(string other) { return *this == CstType(other); }
 
@@ -0,0 +1,107 @@
+#include "stat_cache.hpp"
+
+#include <dirent.h>
+#include <fstream>
+#include <optional>
+
+StatCache stat_cache;
+
+map<string, filesystem::file_type> StatCache::list(const string& directory) {
+    map<string, filesystem::file_type> entries = {};
+    DIR*                               dir     = opendir(directory.c_str());
+    if (dir == nullptr) { return entries; }
+    while (dirent* entry = readdir(dir)) {
+        filesystem::file_type type;
+        switch (entry->d_type) {
+            case DT_REG : type = filesystem::file_type::regular; break;
+            case DT_DIR : type = filesystem::file_type::directory; break;
+            case DT_FIFO : type = filesystem::file_type::fifo; break;
+            case DT_SOCK : type = filesystem::file_type::socket; break;
+            case DT_CHR : type = filesystem::file_type::character; break;
+            case DT_BLK : type = filesystem::file_type::block; break;
+            default : type = filesystem::file_type::unknown; // symlinks and filesystems without d_type
+        }
+        entries[entry->d_name] = type;
+    }
+    closedir(dir);
+    return entries;
+}
+
+filesystem::file_type StatCache::type(const filesystem::path& path) {
+    filesystem::path normal    = path.lexically_normal();
+    string           name      = normal.filename().string();
+    string           directory = normal.parent_path().string();
+    if (name.empty()) { // "dir/" names the directory itself
+        name      = normal.parent_path().filename().string();
+        directory = normal.parent_path().parent_path().string();
+    }
+    if (directory.empty()) { directory = "."; }
+    if (name.empty() or name == "." or name == "..") { // no entry to look up, ask the filesystem
+        error_code error;
+        return filesystem::status(path, error).type();
+    }
+
+    // the entry in a listed directory, nullopt if the directory was not listed yet
+    auto lookup = [&]() -> optional<filesystem::file_type> {
+        auto listing = directories.find(directory);
+        if (listing == directories.end()) { return nullopt; }
+        auto entry = listing->second.find(name);
+        return entry == listing->second.end() ? filesystem::file_type::not_found : entry->second;
+    };
+
+    optional<filesystem::file_type> found;
+    {
+        lock_guard<mutex> guard(lock);
+        found = lookup();
+    }
+    if (not found.has_value()) { // read outside of the lock, if two threads list a directory one listing is dropped
+        map<string, filesystem::file_type> entries = list(directory);
+        lock_guard<mutex>                  guard(lock);
+        if (directories.try_emplace(directory, std::move(entries)).second) { listings++; }
+        found = lookup();
+    }
+    if (*found == filesystem::file_type::unknown) { // stat the entries readdir could not tell the kind of once
+        error_code error;
+        found = filesystem::status(normal, error).type();
+        if (*found == filesystem::file_type::none) { found = filesystem::file_type::not_found; }
+        lock_guard<mutex> guard(lock);
+        directories[directory][name] = *found;
+    }
+    return *found;
+}
+
+usize StatCache::listed() const {
+    lock_guard<mutex> guard(lock);
+    return listings;
+}
+
+void StatCache::clear() {
+    lock_guard<mutex> guard(lock);
+    directories.clear();
+}
+
+TEST_CASE ("Testing StatCache", "[helpers]") {
+    filesystem::path dir = filesystem::temp_directory_path() / "cstc_stat_cache_test";
+    filesystem::remove_all(dir);
+    filesystem::create_directories(dir / "sub");
+    ofstream(dir / "a.cst") << "a";
+    filesystem::create_symlink(dir / "a.cst", dir / "link.cst");
+
+    StatCache cache;
+    REQUIRE(cache.isFile(dir / "a.cst"));
+    REQUIRE(cache.isFile(dir / "link.cst"));
+    REQUIRE(cache.type(dir / "sub") == filesystem::file_type::directory);
+    REQUIRE(cache.type(dir / "sub/") == filesystem::file_type::directory);
+    REQUIRE(cache.isFile(dir / "sub/../a.cst"));
+    REQUIRE(not cache.exists(dir / "b.cst"));
+    REQUIRE(not cache.exists(dir / "missing/b.cst"));
+    REQUIRE(cache.listed() == 2); // dir and missing
+
+    // the listing is kept until it is cleared
+    ofstream(dir / "b.cst") << "b";
+    REQUIRE(not cache.exists(dir / "b.cst"));
+    cache.clear();
+    REQUIRE(cache.exists(dir / "b.cst"));
+
+    filesystem::remove_all(dir);
+}
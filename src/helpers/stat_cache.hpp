@@ -0,0 +1,45 @@
+#pragma once
+#include "../snippets.hpp"
+
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+
+using namespace std;
+
+///
+/// \brief answers existence and file kind queries from directory listings kept in memory
+///
+/// A directory is read with a single readdir the first time a path in it is queried,
+/// every later query for that directory does not touch the filesystem.
+/// Files created or removed after their directory was listed are not seen until clear().
+///
+class StatCache final {
+        map<string, map<string, filesystem::file_type>> directories = {}; ///< listed directories and their entries
+        usize                                           listings    = 0;  ///< readdir runs so far
+        mutable mutex                                   lock;
+
+        /// \brief read a directory, a directory that can not be opened has no entries
+        static map<string, filesystem::file_type> list(const string& directory);
+
+    public:
+        /// \brief get the kind of a file, symlinks are followed
+        ///
+        /// \return filesystem::file_type::not_found if there is no such file
+        filesystem::file_type type(const filesystem::path& path);
+
+        /// \brief check if there is a file (of any kind) at path
+        bool exists(const filesystem::path& path) { return type(path) != filesystem::file_type::not_found; }
+
+        /// \brief check if there is a regular file at path
+        bool isFile(const filesystem::path& path) { return type(path) == filesystem::file_type::regular; }
+
+        /// \brief get the number of directories read so far
+        usize listed() const;
+
+        /// \brief forget all listings
+        void clear();
+};
+
+extern StatCache stat_cache; ///< file lookups of all sessions, Module::refresh() clears it
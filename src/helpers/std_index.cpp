@@ -0,0 +1,251 @@
+#include "std_index.hpp"
+
+#include "string_functions.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// layout: Header, Slot[slot_count], Directory[directory_count], names
+struct StdIndex::Header {
+        char   magic[8];
+        uint32 version;
+        uint32 slot_count; ///< power of 2, at least twice the number of entries
+        uint32 entry_count;
+        uint32 directory_count;
+        uint64 names_size;
+};
+
+struct StdIndex::Slot {
+        uint64 name_hash;
+        uint32 name; ///< offset in names
+        uint32 name_length;
+        uint32 flags; ///< has_header_flag | has_source_flag, 0 for empty slots
+        uint32 reserved;
+};
+
+struct StdIndex::Directory {
+        int64  mtime; ///< nanoseconds
+        uint32 path;  ///< offset in names, relative to the root
+        uint32 path_length;
+};
+
+constexpr char   index_magic[8]  = {'C', 'S', 'T', 'I', 'D', 'X', '\0', '\0'};
+constexpr uint32 index_version   = 2;
+constexpr uint32 has_header_flag = 1;
+constexpr uint32 has_source_flag = 2;
+
+/// \brief get the modification time of a file in nanoseconds, -1 if it can not be stat-ed
+///
+static int64 mtimeOf(const string& path) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) { return -1; }
+    return (int64) info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+}
+
+StdIndex::StdIndex(string root) : root(std::move(root)) {
+    if (this->root.empty()) { return; }
+    string path = this->root + "/" + file_name;
+    if (map(path) and valid()) {
+        was_reused = true;
+        return;
+    }
+    if (mapping != nullptr) {
+        munmap(mapping, size);
+        mapping = nullptr;
+    }
+
+    vector<char> image = build();
+    // written next to the file and renamed, so a reader never maps a partial index
+    string temporary = path + "." + to_string(getpid());
+    bool   written   = false;
+    if (FILE* out = fopen(temporary.c_str(), "wb")) {
+        written = fwrite(image.data(), 1, image.size(), out) == image.size();
+        written = fclose(out) == 0 and written;
+        written = written and rename(temporary.c_str(), path.c_str()) == 0;
+        if (not written) { unlink(temporary.c_str()); }
+    }
+    if (written) { // writing the index touched the root, record its time after that
+        Header*    header = (Header*) image.data();
+        Directory* root_directory =
+            (Directory*) (image.data() + sizeof(Header) + header->slot_count * sizeof(Slot));
+        root_directory->mtime = mtimeOf(this->root);
+        int fd                = open(path.c_str(), O_WRONLY);
+        if (fd >= 0) {
+            usize offset = (char*) root_directory - image.data();
+            written      = pwrite(fd, root_directory, sizeof(Directory), offset) == sizeof(Directory);
+            close(fd);
+        }
+    }
+    if (written and map(path) and valid()) { return; }
+    if (mapping != nullptr) {
+        munmap(mapping, size);
+        mapping = nullptr;
+    }
+    owned = std::move(image);
+    data  = owned.data();
+    size  = owned.size();
+}
+
+StdIndex::~StdIndex() {
+    if (mapping != nullptr) { munmap(mapping, size); }
+}
+
+bool StdIndex::map(const string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) { return false; }
+    struct stat info;
+    if (fstat(fd, &info) == 0 and S_ISREG(info.st_mode) and info.st_size >= (off_t) sizeof(Header)) {
+        void* map = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            mapping = map;
+            size    = info.st_size;
+            data    = (const char*) map;
+        }
+    }
+    close(fd);
+    return mapping != nullptr;
+}
+
+bool StdIndex::valid() const {
+    if (size < sizeof(Header)) { return false; }
+    const Header* header = (const Header*) data;
+    if (memcmp(header->magic, index_magic, sizeof(index_magic)) != 0 or header->version != index_version) {
+        return false;
+    }
+    if (header->slot_count == 0 or (header->slot_count & (header->slot_count - 1)) != 0) { return false; }
+    usize names = sizeof(Header) + header->slot_count * sizeof(Slot) + header->directory_count * sizeof(Directory);
+    if (size != names + header->names_size) { return false; }
+
+    const Directory* directories = (const Directory*) (data + sizeof(Header) + header->slot_count * sizeof(Slot));
+    for (uint32 i = 0; i < header->directory_count; i++) {
+        if (directories[i].path + directories[i].path_length > header->names_size) { return false; }
+        string path = root + "/" + string(data + names + directories[i].path, directories[i].path_length);
+        if (mtimeOf(path) != directories[i].mtime) { return false; }
+    }
+    return true;
+}
+
+vector<char> StdIndex::build() const {
+    std::map<string, Entry> modules     = {};
+    vector<string>          directories = {""};
+
+    error_code error;
+    for (filesystem::recursive_directory_iterator it(root, filesystem::directory_options::skip_permission_denied, error),
+         end;
+         not error and it != end;
+         it.increment(error)) {
+        string relative = filesystem::relative(it->path(), root, error).generic_string();
+        if (it->is_directory(error)) {
+            directories.push_back(relative);
+            continue;
+        }
+        string extension = it->path().extension().string();
+        if (not it->is_regular_file(error) or (extension != ".cst" and extension != ".hst")) { continue; }
+
+        string name = relative.substr(0, relative.size() - extension.size());
+        for (usize pos = name.find('/'); pos != string::npos; pos = name.find('/', pos + 2)) {
+            name.replace(pos, 1, "::");
+        }
+        Entry& entry = modules[name];
+        if (extension == ".hst") {
+            entry.has_header = true;
+        } else {
+            entry.has_source = true;
+        }
+    }
+
+    uint32 slot_count = 1;
+    while (slot_count < modules.size() * 2) { slot_count *= 2; }
+    vector<Slot>      slots(slot_count, Slot {});
+    vector<Directory> records = {};
+    string            names   = "";
+    for (auto& [name, entry] : modules) {
+        uint64 hash = fnv1a(name);
+        uint32 i    = hash & (slot_count - 1);
+        while (slots[i].flags != 0) { i = (i + 1) & (slot_count - 1); }
+        slots[i] = {hash,
+                    (uint32) names.size(),
+                    (uint32) name.size(),
+                    (entry.has_header ? has_header_flag : 0) | (entry.has_source ? has_source_flag : 0),
+                    0};
+        names += name;
+    }
+    for (string& directory : directories) {
+        records.push_back({mtimeOf(root + "/" + directory), (uint32) names.size(), (uint32) directory.size()});
+        names += directory;
+    }
+
+    Header header;
+    memcpy(header.magic, index_magic, sizeof(index_magic));
+    header.version         = index_version;
+    header.slot_count      = slot_count;
+    header.entry_count     = modules.size();
+    header.directory_count = records.size();
+    header.names_size      = names.size();
+
+    vector<char> image = {};
+    image.insert(image.end(), (char*) &header, (char*) &header + sizeof(Header));
+    image.insert(image.end(), (char*) slots.data(), (char*) (slots.data() + slots.size()));
+    image.insert(image.end(), (char*) records.data(), (char*) (records.data() + records.size()));
+    image.insert(image.end(), names.begin(), names.end());
+    return image;
+}
+
+optional<StdIndex::Entry> StdIndex::find(string_view module_name) const {
+    if (data == nullptr) { return nullopt; }
+    const Header* header = (const Header*) data;
+    const Slot*   slots  = (const Slot*) (data + sizeof(Header));
+    const char*   names  = data + sizeof(Header) + header->slot_count * sizeof(Slot) +
+                        header->directory_count * sizeof(Directory);
+
+    uint64 hash = fnv1a(module_name);
+    for (uint32 i = hash & (header->slot_count - 1); slots[i].flags != 0; i = (i + 1) & (header->slot_count - 1)) {
+        if (slots[i].name_hash == hash and string_view(names + slots[i].name, slots[i].name_length) == module_name) {
+            return Entry {(slots[i].flags & has_header_flag) != 0, (slots[i].flags & has_source_flag) != 0};
+        }
+    }
+    return nullopt;
+}
+
+usize StdIndex::count() const {
+    if (data == nullptr) { return 0; }
+    return ((const Header*) data)->entry_count;
+}
+
+TEST_CASE ("Testing StdIndex", "[helpers]") {
+    filesystem::path root = filesystem::temp_directory_path() / "cstc_std_index_test";
+    filesystem::remove_all(root);
+    filesystem::create_directories(root / "io");
+    ofstream(root / "lang.cst") << "lang";
+    ofstream(root / "io/file.cst") << "file";
+    ofstream(root / "io/file.hst") << "header";
+    ofstream(root / "io/net.hst") << "net";
+
+    for (bool reused : {false, true}) {
+        StdIndex index(root.string());
+        REQUIRE(index.reused() == reused);
+        REQUIRE(index.count() == 3);
+        REQUIRE(index.find("lang")->has_source);
+        REQUIRE(not index.find("lang")->has_header);
+        REQUIRE(index.find("io::file")->has_header);
+        REQUIRE(not index.find("io::net")->has_source);
+        REQUIRE(not index.find("io").has_value());
+        REQUIRE(not index.find("missing").has_value());
+    }
+
+    // a new module changes the directory it is in, timestamps can be coarse so move the time on explicitly
+    ofstream(root / "io/new.cst") << "new";
+    filesystem::last_write_time(root / "io", filesystem::last_write_time(root / "io") + 1s);
+    StdIndex index(root.string());
+    REQUIRE(not index.reused());
+    REQUIRE(index.find("io::new").has_value());
+
+    REQUIRE(not StdIndex("").find("lang").has_value());
+    filesystem::remove_all(root);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "../snippets.hpp"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+///
+/// \brief index of the standard library: module name -> which of its files exist
+///
+/// The index is stored next to the stdlib (`<CSTC_STD>/.cstc-index`) and mapped when opened.
+/// It is rebuilt if any directory of the stdlib changed since it was written,
+/// and kept in memory only if the stdlib is not writable. Lookups are a hash probe into the mapping.
+///
+class StdIndex final {
+    public:
+        ///
+        /// \brief the files of a stdlib module
+        ///
+        struct Entry {
+                bool has_header = false; ///< if there is a .hst file
+                bool has_source = false; ///< if there is a .cst file
+        };
+
+        static constexpr const char* file_name = ".cstc-index"; ///< name of the index in the stdlib directory
+
+    private:
+        struct Header;
+        struct Slot;
+        struct Directory;
+
+        string       root       = "";      ///< stdlib directory
+        vector<char> owned      = {};      ///< the index, if it is not mapped
+        void*        mapping    = nullptr; ///< mmap-ed index file
+        usize        size       = 0;       ///< size of the index
+        const char*  data       = nullptr; ///< the index, mapped or owned
+        bool         was_reused = false;   ///< if an existing index file was valid
+
+        /// \brief check that the index in data is complete and no stdlib directory changed since it was written
+        bool valid() const;
+
+        /// \brief walk the stdlib and encode a new index
+        vector<char> build() const;
+
+        /// \brief map the index file
+        bool map(const string& path);
+
+    public:
+        /// \brief open (and rebuild if needed) the index of a stdlib directory. An empty root gives an empty index
+        explicit StdIndex(string root);
+
+        StdIndex(const StdIndex&)            = delete;
+        StdIndex& operator=(const StdIndex&) = delete;
+        ~StdIndex();
+
+        /// \brief look up a module by its name relative to the stdlib (e.g. "lang" or "io::file")
+        optional<Entry> find(string_view module_name) const;
+
+        /// \brief get the number of modules in the index
+        usize count() const;
+
+        /// \brief check if the index file was reused instead of rebuilt
+        bool reused() const { return was_reused; }
+};
@@ -25,3 +25,21 @@ string rinsert(string val, string target) {
     if (pos != string::npos) { target.replace(pos, 2, val); }
     return target;
 }
+
+string to_string(uint128 value) {
+    string digits = "";
+    do {
+        digits += char('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    return string(digits.rbegin(), digits.rend());
+}
+
+uint64 fnv1a(string_view data, uint64 seed) {
+    uint64 h = seed;
+    for (char c : data) {
+        h ^= (uint8) c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include "../snippets.hpp"
 
 using namespace std;
@@ -27,3 +28,13 @@ extern string insert(string val, string target);
 /// \param target target string to insert into (last "{}")
 ///
 extern string rinsert(string val, string target);
+
+/// \brief convert a 128 bit integer to its decimal representation
+///
+extern string to_string(uint128 value);
+
+/// \brief 64 bit FNV-1a hash of some bytes, used to tell file contents apart
+///
+/// \param seed hash to continue from, to hash several pieces as one
+///
+extern uint64 fnv1a(string_view data, uint64 seed = 14695981039346656037ull);
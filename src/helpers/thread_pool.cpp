@@ -0,0 +1,105 @@
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(usize threads) {
+    if (threads == 0) { threads = max(thread::hardware_concurrency(), 1u); }
+    for (usize i = 0; i < threads; i++) { workers.emplace_back(&ThreadPool::work, this); }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    job_added.notify_all();
+    for (thread& t : workers) { t.join(); }
+}
+
+void ThreadPool::work() {
+    while (true) {
+        function<void()> job;
+        {
+            unique_lock<mutex> guard(lock);
+            job_added.wait(guard, [this]() { return stopping or not jobs.empty(); });
+            if (jobs.empty()) { return; }
+            job = std::move(jobs.front());
+            jobs.pop();
+        }
+        job();
+        {
+            lock_guard<mutex> guard(lock);
+            unfinished--;
+        }
+        job_done.notify_all();
+    }
+}
+
+void ThreadPool::submit(function<void()> job) {
+    {
+        lock_guard<mutex> guard(lock);
+        jobs.push(std::move(job));
+        unfinished++;
+    }
+    job_added.notify_one();
+}
+
+void ThreadPool::wait() {
+    unique_lock<mutex> guard(lock);
+    job_done.wait(guard, [this]() { return unfinished == 0; });
+}
+
+void ThreadPool::parallelFor(usize count, function<void(usize)> body) {
+    if (count == 0) { return; }
+    struct Work {
+            atomic<usize>         next = 0;
+            atomic<usize>         done = 0;
+            usize                 count;
+            function<void(usize)> body;
+            mutex                 lock;
+            condition_variable    finished;
+    };
+    sptr<Work> work = make_shared<Work>();
+    work->count     = count;
+    work->body      = std::move(body);
+
+    // helpers may only get to run after all items are done, they then return right away
+    auto run = [work]() {
+        for (usize k = work->next++; k < work->count; k = work->next++) {
+            work->body(k);
+            if (++work->done == work->count) {
+                lock_guard<mutex> guard(work->lock);
+                work->finished.notify_all();
+            }
+        }
+    };
+    for (usize helper = 1; helper < min(count, workers.size()); helper++) { submit(run); }
+    run();
+
+    unique_lock<mutex> guard(work->lock);
+    work->finished.wait(guard, [&work]() { return work->done == work->count; });
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+TEST_CASE ("Testing ThreadPool", "[helpers]") {
+    ThreadPool    pool(4);
+    atomic<usize> sum = 0;
+    for (usize i = 1; i <= 100; i++) {
+        pool.submit([&sum, i]() { sum += i; });
+    }
+    pool.wait();
+    REQUIRE(pool.size() == 4);
+    REQUIRE(sum == 5050);
+
+    vector<usize> squares(50, 0);
+    pool.parallelFor(squares.size(), [&](usize i) {
+        // nested calls must not dead lock
+        pool.parallelFor(1, [&](usize) { squares[i] = i * i; });
+    });
+    for (usize i = 0; i < squares.size(); i++) { REQUIRE(squares[i] == i * i); }
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "../snippets.hpp"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+///
+/// \brief fixed set of worker threads running submitted jobs
+///
+/// Jobs must not wait() on the pool they run in, every worker could end up waiting.
+/// parallelFor() can be nested, the calling thread works on its own items.
+///
+class ThreadPool final {
+        vector<thread>          workers    = {};
+        queue<function<void()>> jobs       = {};
+        usize                   unfinished = 0; ///< submitted jobs that did not finish yet
+        bool                    stopping   = false;
+        mutex                   lock;
+        condition_variable      job_added;
+        condition_variable      job_done;
+
+        void work();
+
+    public:
+        /// \brief start a pool
+        ///
+        /// \param threads number of workers, 0 picks the number of hardware threads
+        explicit ThreadPool(usize threads = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&)            = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /// \brief queue a job for the workers
+        void submit(function<void()> job);
+
+        /// \brief block until all submitted jobs finished
+        void wait();
+
+        /// \brief run body(0) ... body(count - 1) on the workers and the calling thread
+        ///
+        /// Returns once every call finished.
+        void parallelFor(usize count, function<void(usize)> body);
+
+        /// \brief get the number of workers
+        usize size() const { return workers.size(); }
+
+        /// \brief get the pool shared by the whole compiler
+        static ThreadPool& shared();
+};
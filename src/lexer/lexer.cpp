@@ -1,52 +1,52 @@
 #include "lexer.hpp"
 
 #include "../errors/errors.hpp"
+#include "../helpers/string_functions.hpp"
+#include "../helpers/thread_pool.hpp"
+#include "../session.hpp"
 #include "../snippets.hpp"
+#include "scan.hpp"
+#include "spelling.hpp"
 #include "token.hpp"
 
+#include <array>
+#include <chrono>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <random>
 #include <regex>
 #include <string>
+#include <string_view>
 #include <vector>
 
-int32 lexer::pretty_size = 120; ///< max line len before warning
+bool lexer::fast_scan = true; ///< skip whitespace, comments and literals in blocks
+
+usize lexer::parallel_threshold = 4 * 1024 * 1024; ///< sources from this size on are lexed in parallel
+usize lexer::chunk_size         = 512 * 1024;      ///< approximate size of the chunks lexed in parallel
+
+namespace {
+
+    /// \brief generate the lookup table for single-char delimiters from lexer::spellings
+    ///
+    constexpr std::array<lexer::Token::Type, 256> makeSingleTokens() {
+        std::array<lexer::Token::Type, 256> types {};
+        types.fill(lexer::Token::Type::NONE);
+        for (const lexer::Spelling& s : lexer::spellings) {
+            if (s.kind & lexer::Spelling::OPERATOR and s.text.size() == 1) { types[(uint8) s.text[0]] = s.type; }
+        }
+        return types;
+    }
+
+    constexpr std::array<lexer::Token::Type, 256> single_tokens = makeSingleTokens();
+
+} // namespace
 
 /// \brief try to fit a delimiting token into a single-char buffer
 ///
 /// \return token type found or Token::Type::NONE. \see lexer::Token::Type
 lexer::Token::Type lexer::getSingleToken(char c) {
-    switch (c) {
-        case ';' : return lexer::Token::Type::END_CMD;
-
-        case '=' : return lexer::Token::Type::SET;
-        case '+' : return lexer::Token::Type::ADD;
-        case '-' : return lexer::Token::Type::SUB;
-        case '*' : return lexer::Token::Type::MUL;
-        case '/' : return lexer::Token::Type::DIV;
-        case '%' : return lexer::Token::Type::MOD;
-        case '~' : return lexer::Token::Type::NEG;
-        case '&' : return lexer::Token::Type::AND;
-        case '|' : return lexer::Token::Type::OR;
-        case '^' : return lexer::Token::Type::XOR;
-
-        case '<' : return lexer::Token::Type::LT;
-        case '>' : return lexer::Token::Type::GT;
-
-        case '?' : return lexer::Token::Type::QM;
-        case ':' : return lexer::Token::Type::IN;
-        case '#' : return lexer::Token::Type::REF;
-        case '.' : return lexer::Token::Type::ACCESS;
-        case ',' : return lexer::Token::Type::COMMA;
-
-        case '(' : return lexer::Token::Type::OPEN;
-        case ')' : return lexer::Token::Type::CLOSE;
-        case '{' : return lexer::Token::Type::BLOCK_OPEN;
-        case '}' : return lexer::Token::Type::BLOCK_CLOSE;
-        case '[' : return lexer::Token::Type::INDEX_OPEN;
-        case ']' : return lexer::Token::Type::INDEX_CLOSE;
-        default  : return lexer::Token::Type::NONE;
-    }
+    return single_tokens[(uint8) c];
 }
 
 /// \brief try to fit a delimiting token into a string
@@ -54,40 +54,147 @@ lexer::Token::Type lexer::getSingleToken(char c) {
 /// \param s string has to have length 2!
 ///
 /// \return token type found or Token::Type::NONE. \see lexer::Token::Type
-lexer::Token::Type lexer::getDoubleToken(string s) {
-    if (s == "++") { return lexer::Token::Type::INC; }
-    if (s == "--") { return lexer::Token::Type::DEC; }
-    if (s == "**") { return lexer::Token::Type::POW; }
+lexer::Token::Type lexer::getDoubleToken(string_view s) {
+    return lookupSpelling(s, Spelling::OPERATOR);
+}
 
-    if (s == "<<") { return lexer::Token::Type::SHL; }
-    if (s == ">>") { return lexer::Token::Type::SHR; }
-    if (s == "!>") { return lexer::Token::Type::LSHR; }
+namespace {
+
+    /// \brief character classes the classifier DFA distinguishes
+    ///
+    enum CharClass : uint8 {
+        CC_ZERO,   ///< `0`
+        CC_ONE,    ///< `1`
+        CC_DIGIT,  ///< `2`-`9`
+        CC_B,      ///< `b` (binary prefix, hex digit, lowercase)
+        CC_X,      ///< `x` (hex prefix, lowercase)
+        CC_HEXL,   ///< `a`, `c`-`f` (hex digit, lowercase)
+        CC_HEXU,   ///< `A`-`F`
+        CC_LOWER,  ///< any other lowercase letter
+        CC_SQUOTE, ///< `'`
+        CC_DQUOTE, ///< `"`
+        CC_OTHER,  ///< everything else
+        CC_COUNT
+    };
+
+    /// \brief states of the classifier DFA
+    ///
+    enum State : uint8 {
+        S_START,      ///< nothing read yet
+        S_ZERO,       ///< `0`
+        S_DEC,        ///< `[0-9]+`
+        S_HEX_PRE,    ///< `0x`
+        S_HEX,        ///< `0x[0-9a-fA-F]+`
+        S_BIN_PRE,    ///< `0b`
+        S_BIN,        ///< `0b[01]+`
+        S_WORD,       ///< `[a-z]+`, might be a keyword
+        S_CHAR,       ///< inside `'...`
+        S_CHAR_END,   ///< `'...'`
+        S_STRING,     ///< inside `"...`
+        S_STRING_END, ///< `"..."`
+        S_SYMBOL,     ///< sink: anything else is a symbol
+        S_COUNT
+    };
+
+    /// \brief generate the character class lookup table
+    ///
+    constexpr std::array<uint8, 256> makeCharClasses() {
+        std::array<uint8, 256> classes {};
+        for (uint32 c = 0; c < 256; c++) { classes[c] = CC_OTHER; }
+        for (uint32 c = 'a'; c <= 'z'; c++) { classes[c] = CC_LOWER; }
+        for (uint32 c = 'a'; c <= 'f'; c++) { classes[c] = CC_HEXL; }
+        for (uint32 c = 'A'; c <= 'F'; c++) { classes[c] = CC_HEXU; }
+        for (uint32 c = '2'; c <= '9'; c++) { classes[c] = CC_DIGIT; }
+        classes['0']  = CC_ZERO;
+        classes['1']  = CC_ONE;
+        classes['b']  = CC_B;
+        classes['x']  = CC_X;
+        classes['\''] = CC_SQUOTE;
+        classes['"']  = CC_DQUOTE;
+        return classes;
+    }
 
-    if (s == "==") { return lexer::Token::Type::EQ; }
-    if (s == "!=") { return lexer::Token::Type::NEQ; }
-    if (s == ">=") { return lexer::Token::Type::GEQ; }
-    if (s == "<=") { return lexer::Token::Type::LEQ; }
+    /// \brief generate the transition table of the classifier DFA
+    ///
+    constexpr std::array<std::array<uint8, CC_COUNT>, S_COUNT> makeTransitions() {
+        std::array<std::array<uint8, CC_COUNT>, S_COUNT> next {};
+        for (auto& row : next) {
+            for (auto& n : row) { n = S_SYMBOL; }
+        }
+        auto set = [&](State from, std::initializer_list<CharClass> on, State to) {
+            for (CharClass c : on) { next[from][c] = to; }
+        };
+        const auto digits = {CC_ZERO, CC_ONE, CC_DIGIT};
+        const auto lower  = {CC_B, CC_X, CC_HEXL, CC_LOWER};
+        const auto hex    = {CC_ZERO, CC_ONE, CC_DIGIT, CC_B, CC_HEXL, CC_HEXU};
+
+        set(S_START, {CC_ZERO}, S_ZERO);
+        set(S_START, {CC_ONE, CC_DIGIT}, S_DEC);
+        set(S_START, lower, S_WORD);
+        set(S_START, {CC_SQUOTE}, S_CHAR_END);
+        set(S_START, {CC_DQUOTE}, S_STRING_END);
+
+        set(S_ZERO, digits, S_DEC);
+        set(S_ZERO, {CC_X}, S_HEX_PRE);
+        set(S_ZERO, {CC_B}, S_BIN_PRE);
+        set(S_DEC, digits, S_DEC);
+        set(S_HEX_PRE, hex, S_HEX);
+        set(S_HEX, hex, S_HEX);
+        set(S_BIN_PRE, {CC_ZERO, CC_ONE}, S_BIN);
+        set(S_BIN, {CC_ZERO, CC_ONE}, S_BIN);
+        set(S_WORD, lower, S_WORD);
+
+        // literals only care about their last character
+        for (uint8 c = 0; c < CC_COUNT; c++) {
+            next[S_CHAR][c]       = c == CC_SQUOTE ? S_CHAR_END : S_CHAR;
+            next[S_CHAR_END][c]   = c == CC_SQUOTE ? S_CHAR_END : S_CHAR;
+            next[S_STRING][c]     = c == CC_DQUOTE ? S_STRING_END : S_STRING;
+            next[S_STRING_END][c] = c == CC_DQUOTE ? S_STRING_END : S_STRING;
+        }
+        return next;
+    }
 
-    if (s == "<-") { return lexer::Token::Type::UNPACK; }
-    if (s == "::") { return lexer::Token::Type::SUBNS; }
-    if (s == "..") { return lexer::Token::Type::DOTDOT; }
+    constexpr std::array<uint8, 256>                          char_classes = makeCharClasses();
+    constexpr std::array<std::array<uint8, CC_COUNT>, S_COUNT> transitions  = makeTransitions();
 
-    return lexer::Token::Type::NONE;
-}
+} // namespace
 
 /// \brief try to find the token type of a token that does not fit getSingleToken or getDoubleToken
 ///
+/// Runs a table-driven DFA over the bytes of the buffer once. Literals are recognized by their
+/// accepting state, words made of lowercase letters are additionally checked for keywords.
+///
 /// \param c string buffer
 ///
 /// \return token type found or Token::Type::NONE. \see lexer::Token::Type
-lexer::Token::Type lexer::matchType(string c) {
-    // fallback = everything else
-    lexer::Token::Type type = lexer::Token::Type::SYMBOL;
+lexer::Token::Type lexer::matchType(string_view c) {
+    uint8 state = S_START;
+    for (char ch : c) {
+        state = transitions[state][char_classes[(uint8) ch]];
+        if (state == S_SYMBOL) { return lexer::Token::Type::SYMBOL; }
+    }
+
+    switch (state) {
+        case S_ZERO       :
+        case S_DEC        : return lexer::Token::Type::INT;
+        case S_HEX        : return lexer::Token::Type::HEX;
+        case S_BIN        : return lexer::Token::Type::BINARY;
+        case S_CHAR_END   : return lexer::Token::Type::CHAR;
+        case S_STRING_END : return lexer::Token::Type::STRING;
+        case S_WORD       : {
+            lexer::Token::Type keyword = lookupSpelling(c, Spelling::KEYWORD);
+            return keyword == lexer::Token::Type::NONE ? lexer::Token::Type::SYMBOL : keyword;
+        }
+        default           : return lexer::Token::Type::SYMBOL;
+    }
+}
 
-    // bool literal
+/// \brief reference implementation of lexer::matchType using regular expressions
+///
+/// Kept for checking the DFA against it in tests and benchmarks.
+lexer::Token::Type matchTypeRegex(const string& c) {
     if (c == "true" or c == "false") { return lexer::Token::Type::BOOL; }
 
-    // int literal
     const std::regex int_regex("[0-9]+");
     const std::regex hex_regex("0x[0-9a-fA-F]+");
     const std::regex binary_regex("0b[0-1]+");
@@ -96,86 +203,103 @@ lexer::Token::Type lexer::matchType(string c) {
     if (regex_match(c.c_str(), hex_regex)) { return lexer::Token::Type::HEX; }
     if (regex_match(c.c_str(), binary_regex)) { return lexer::Token::Type::BINARY; }
 
-    // char & string literal
     if (c[0] == '\'' and c[c.size() - 1] == '\'') { return lexer::Token::Type::CHAR; }
     if (c[0] == '\"' and c[c.size() - 1] == '\"') { return lexer::Token::Type::STRING; }
 
-    // Keywords
-    if (c == "as") {
-        type = lexer::Token::Type::AS;
-    } else if (c == "and") {
-        type = lexer::Token::Type::LAND;
-    } else if (c == "or") {
-        type = lexer::Token::Type::LOR;
-    } else if (c == "not") {
-        type = lexer::Token::Type::NOT;
-    } else if (c == "if") {
-        type = lexer::Token::Type::IF;
-    } else if (c == "else") {
-        type = lexer::Token::Type::ELSE;
-    } else if (c == "for") {
-        type = lexer::Token::Type::FOR;
-    } else if (c == "while") {
-        type = lexer::Token::Type::WHILE;
-    } else if (c == "return") {
-        type = lexer::Token::Type::RETURN;
-    } else if (c == "continue") {
-        type = lexer::Token::Type::CONTINUE;
-    } else if (c == "break") {
-        type = lexer::Token::Type::BREAK;
-    } else if (c == "namespace") {
-        type = lexer::Token::Type::NAMESPACE;
-    } else if (c == "import") {
-        type = lexer::Token::Type::IMPORT;
-    } else if (c == "noimpl") {
-        type = lexer::Token::Type::NOIMPL;
-    } else if (c == "class") {
-        type = lexer::Token::Type::CLASS;
-    } else if (c == "struct") {
-        type = lexer::Token::Type::STRUCT;
-    } else if (c == "enum") {
-        type = lexer::Token::Type::ENUM;
-    } else if (c == "mut") {
-        type = lexer::Token::Type::MUT;
-    } else if (c == "abstract") {
-        type = lexer::Token::Type::ABSTRACT;
-    } else if (c == "public") {
-        type = lexer::Token::Type::PUBLIC;
-    } else if (c == "switch") {
-        type = lexer::Token::Type::SWITCH;
-    } else if (c == "case") {
-        type = lexer::Token::Type::CASE;
-    } else if (c == "private") {
-        type = lexer::Token::Type::PRIVATE;
-    } else if (c == "protected") {
-        type = lexer::Token::Type::PROTECTED;
-    } else if (c == "const") {
-        type = lexer::Token::Type::CONST;
-    } else if (c == "static") {
-        type = lexer::Token::Type::STATIC;
-    } else if (c == "throw") {
-        type = lexer::Token::Type::THROW;
-    } else if (c == "new") {
-        type = lexer::Token::Type::NEW;
-    } else if (c == "virtual") {
-        type = lexer::Token::Type::VIRTUAL;
-    } else if (c == "delete") {
-        type = lexer::Token::Type::DELETE;
-    } else if (c == "operator") {
-        type = lexer::Token::Type::OPERATOR;
-    } else if (c == "finally") {
-        type = lexer::Token::Type::FINALLY;
-    } else if (c == "nowrap") {
-        type = lexer::Token::Type::NOWRAP;
-    } else if (c == "null") {
-        type = lexer::Token::Type::NULV;
-    } else if (c == "x") {
-        type = lexer::Token::Type::X;
-    } else if (c == "include") {
-        type = lexer::Token::Type::INCLUDE;
+    lexer::Token::Type keyword = lexer::lookupSpelling(c, lexer::Spelling::KEYWORD);
+    return keyword == lexer::Token::Type::NONE ? lexer::Token::Type::SYMBOL : keyword;
+}
+
+TEST_CASE ("Testing lexer::matchType", "[lexer]") {
+    string val = GENERATE("0", "00", "0123", "42", "0x", "0x1F", "0xfa", "0xg", "0X1", "0b", "0b0101", "0b012",
+                          "0bx", "1x", "x", "xy", "abc", "Abc", "a1", "_a", "true", "false", "truex", "include",
+                          "as", "nowrap", "'", "'a'", "'\\n'", "'ab", "\"", "\"\"", "\"a b\"", "\"a'", "'a\"",
+                          "a'", "0'", "0b'", "ab'c'", "\"x\"y\"", "\xc3\xa4");
+    REQUIRE (lexer::matchType(val) == matchTypeRegex(val));
+}
+
+#ifdef CATCH2 // the fallback drops WARN, which would leave the measurements unused
+TEST_CASE ("Benchmarking lexer::matchType", "[.benchmark][lexer]") {
+    string words[] = {"foo", "bar_baz", "int32", "return", "0x1fA", "0b1011", "12345", "'c'", "\"a string\"",
+                      "include", "Value", "x", "true", "namespace", "someLongerIdentifierName"};
+    usize  bytes   = 0;
+    for (string& w : words) { bytes += w.size(); }
+
+    auto throughput = [&](auto classify) {
+        usize rounds = 2000;
+        usize found  = 0;
+        auto  start  = std::chrono::steady_clock::now();
+        for (usize r = 0; r < rounds; r++) {
+            for (string& w : words) { found += classify(w); }
+        }
+        float64 seconds = std::chrono::duration<float64>(std::chrono::steady_clock::now() - start).count();
+        FORGET(found);
+        return float64(bytes * rounds) / seconds / 1e6;
+    };
+
+    WARN ("lexer::matchType: " << throughput([](const string& w) { return lexer::matchType(w); }) << " MB/s, "
+          << "regex reference: " << throughput([](const string& w) { return matchTypeRegex(w); }) << " MB/s");
+
+    BENCHMARK ("lexer::matchType") {
+        usize found = 0;
+        for (string& w : words) { found += lexer::matchType(w); }
+        return found;
+    };
+    BENCHMARK ("regex reference") {
+        usize found = 0;
+        for (string& w : words) { found += matchTypeRegex(w); }
+        return found;
+    };
+}
+#endif
+
+/// \brief decode the value of a numeric literal
+///
+/// \param c    literal text, including the `0x` or `0b` prefix
+/// \param type Token::INT, Token::HEX or Token::BINARY
+///
+/// \return the value, or 0 for other token types
+lexer::NumericLiteral lexer::decodeNumber(string_view c, Token::Type type) {
+    NumericLiteral literal = {};
+    uint32         base;
+    switch (type) {
+        case Token::INT    : base = 10; break;
+        case Token::HEX    : base = 16; c.remove_prefix(2); break;
+        case Token::BINARY : base = 2; c.remove_prefix(2); break;
+        default            : return literal;
     }
+    for (char ch : c) {
+        uint32 digit = ch <= '9' ? ch - '0' : (ch | 0x20) - 'a' + 10;
+        if (literal.value > (~uint128(0) - digit) / base) { literal.overflow = true; }
+        literal.value = literal.value * base + digit;
+    }
+    return literal;
+}
 
-    return type;
+TEST_CASE ("Testing lexer::decodeNumber", "[lexer]") {
+    uint128 max = ~uint128(0);
+
+    REQUIRE(lexer::decodeNumber("0", lexer::Token::INT).value == 0);
+    REQUIRE(lexer::decodeNumber("0123", lexer::Token::INT).value == 123);
+    REQUIRE(lexer::decodeNumber("18446744073709551616", lexer::Token::INT).value == uint128(1) << 64);
+    REQUIRE(lexer::decodeNumber("0x1F", lexer::Token::HEX).value == 31);
+    REQUIRE(lexer::decodeNumber("0xfa", lexer::Token::HEX).value == 250);
+    REQUIRE(lexer::decodeNumber("0b0101", lexer::Token::BINARY).value == 5);
+    REQUIRE(lexer::decodeNumber("abc", lexer::Token::SYMBOL).value == 0);
+
+    lexer::NumericLiteral biggest = lexer::decodeNumber("0x" + string(32, 'f'), lexer::Token::HEX);
+    REQUIRE(biggest.value == max);
+    REQUIRE(not biggest.overflow);
+    REQUIRE(lexer::decodeNumber("0x1" + string(32, '0'), lexer::Token::HEX).overflow);
+    REQUIRE(not lexer::decodeNumber(to_string(max), lexer::Token::INT).overflow);
+    REQUIRE(lexer::decodeNumber(to_string(max) + "0", lexer::Token::INT).overflow);
+    REQUIRE(lexer::decodeNumber("0b1" + string(128, '0'), lexer::Token::BINARY).overflow);
+
+    lexer::TokenStream tokens = lexer::tokenize("a = 0x10 + 42;");
+    REQUIRE(tokens[2].number().value == 16);
+    REQUIRE(tokens[4].number().value == 42);
+    REQUIRE(tokens[2].literal != 0);
+    REQUIRE(tokens[0].literal == 0);
 }
 
 /// \brief check if a is a delimiter
@@ -184,31 +308,51 @@ lexer::Token::Type lexer::matchType(string c) {
 
 /// \brief handle and clear the buffer (add a token if the buffer is not empty)
 ///
-#define handleBuffer()                                                                                            \
-    if (buffer.size() > 0) {                                                                                      \
-        tokens->push_back(                                                                                        \
-            Token(matchType(buffer), buffer, line, col - buffer.size(), make_shared<string>(filename), lc));      \
-        if (pretty_size != -1 and col > (uint64) pretty_size) too_long.push_back(tokens->at(tokens->size() - 1)); \
-        buffer = "";                                                                                              \
+#define handleBuffer()                                                                                           \
+    if (buffer_len > 0) {                                                                                        \
+        tokens.push_back(Token(matchType(string_view(text).substr(buffer_start, buffer_len)),                    \
+                               &source,                                                                          \
+                               buffer_start,                                                                     \
+                               buffer_len));                                                                     \
+        if (tokens.back().type == Token::INT or tokens.back().type == Token::HEX or                              \
+            tokens.back().type == Token::BINARY) {                                                               \
+            literals->push_back(decodeNumber(tokens.back().value(), tokens.back().type));                       \
+            tokens.back().literal = literals->size();                                                            \
+        }                                                                                                        \
+        if (pretty_size != -1 and i - line_start + 1 > (uint64) pretty_size) too_long.push_back(tokens.back());  \
+        buffer_len = 0;                                                                                          \
+    }
+
+/// \brief add the current char to the buffer
+///
+#define addToBuffer()                          \
+    if (buffer_len == 0) { buffer_start = i; } \
+    buffer_len = i - buffer_start + 1;
+
+/// \brief issue a diagnostic now, or keep it for later if the lexer runs speculatively
+///
+#define report(...)                                                                \
+    if (deferred == nullptr) {                                                     \
+        __VA_ARGS__;                                                               \
+    } else {                                                                       \
+        deferred->push_back([=, &source, too_long = too_long]() { __VA_ARGS__; }); \
     }
 
 /// \brief Update Variables and raise Warning if line is too long
 ///
-#define updateVars()                                                                    \
-    if (c == '\n') {                                                                    \
-        line_comment = false;                                                           \
-        line++;                                                                         \
-        col = 0;                                                                        \
-        lc  = sptr<string>(new string);                                                 \
-        if (too_long.size() > 0) {                                                      \
-            parser::warn(parser::warnings["Line too long"],                             \
-                         {too_long},                                                    \
-                         "It will become hard to read if you do long lines");           \
-            parser::note(too_long,                                                      \
-                         "current max length is "_s + std::to_string(pretty_size) +     \
-                             ", you can adjust this with the --max-line-len argument"); \
-            too_long.clear();                                                           \
-        }                                                                               \
+#define updateVars()                                                                            \
+    if (c == '\n') {                                                                            \
+        line_comment = false;                                                                   \
+        line_start   = i + 1;                                                                   \
+        if (too_long.size() > 0) {                                                              \
+            string limit = "current max length is "_s + std::to_string(pretty_size) +          \
+                           ", you can adjust this with the --max-line-len argument";            \
+            report(parser::warn(parser::warnings["Line too long"],                              \
+                                {too_long},                                                     \
+                                "It will become hard to read if you do long lines");            \
+                   parser::note(too_long, limit));                                              \
+            too_long.clear();                                                                   \
+        }                                                                                       \
     }
 
 /// \brief get a list of tokens from a string.
@@ -224,31 +368,109 @@ lexer::TokenStream lexer::tokenize(string text) {
 ///
 /// \return Vector of Tokens tokenized.
 lexer::TokenStream lexer::tokenize(string text, string filename) {
-    sptr<std::vector<lexer::Token>> tokens =
-        sptr<std::vector<lexer::Token>>(new std::vector<lexer::Token>({})); ///< output Token vector
-    uint64 col          = 0;                                                ///< current column
-    uint64 line         = 1;                                                ///< current line
-    bool   line_comment = false;                                            ///< if currently in a line comment
-    bool   in_string    = false;                                            ///< if in a string
-    bool   in_char      = false;                                            ///< if in a char
-    uint64 ml_comment   = 0; ///< multiline comment level. If 0 => no comment
+    return lexer::tokenize(SourceManager::current().add(std::move(filename), std::move(text)));
+}
+
+lexer::Lexer::Lexer(Source& source)
+    : source(source), text(source.text), pretty_size(CompilationSession::current().pretty_size),
+      literals(&source.literals) {
+    // merge conflicts are skipped across lines, keep them on the serial path
+    if (text.size() >= parallel_threshold and text.find("<<<<<<<< HEAD") == string::npos) {
+        auto start  = std::chrono::steady_clock::now();
+        lexParallel();
+        seconds    += std::chrono::duration<float64>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+lexer::Lexer::Lexer(Source&                   source,
+                   uint32                    begin,
+                   uint32                    end,
+                   LexState                  state,
+                   vector<NumericLiteral>*   literals,
+                   vector<function<void()>>* deferred)
+    : source(source), text(source.text.substr(0, end)), i(begin), line_start(begin), current(state),
+      pretty_size(CompilationSession::current().pretty_size), literals(literals), deferred(deferred),
+      whole_source(false) {}
+
+bool lexer::Lexer::next(Token& token) {
+    while (pulled == released) {
+        if (done and released == tokens.size()) {
+            if (whole_source and not was_aborted) {
+                whole_source = false; // only warn once
+                if (current.ml_comment > 0) { // Some Multiline comment was never closed
+                    parser::warn(parser::warnings["Unclosed multiline comment"],
+                                 {current.ml_open},
+                                 "This multiline comment was never closed. This could cause problems with commented code");
+                }
+                if (count == 0) { // Empty file warning
+                    std::cerr << "\r\e[1;33mWARNING:\e[0m\e[1m " << source.name << "\e[0m appears to be empty.\n";
+                }
+            }
+            return false;
+        }
+        auto start = std::chrono::steady_clock::now(); // once per batch
+        if (not done) {
+            // drop the pulled tokens, the ones in open groups stay
+            tokens.erase(tokens.begin(), tokens.begin() + pulled);
+            for (uint32& o : open) { o -= pulled; }
+            matched -= pulled;
+            released = pulled = 0;
+            lexSome();
+        }
+        matchBrackets();
+        seconds += std::chrono::duration<float64>(std::chrono::steady_clock::now() - start).count();
+    }
+    token = tokens[pulled++];
+    count++;
+    return true;
+}
+
+void lexer::Lexer::lexSome() {
+    // work on locals, so they can stay in registers
+    const Source& source       = this->source;
+    string_view   text         = this->text;
+    uint64        line_start   = this->line_start;
+    bool          line_comment = this->line_comment;
+    bool          in_string    = current.in_string;
+    bool          in_char      = current.in_char;
+    uint64        ml_comment   = current.ml_comment;
 #define NO_COMMENT 0
-    sptr<string> lc = sptr<string>(
-        new string); ///< current line buffer for token debug. Used with an sptr to autodelete when not required
-    Token              ml_open;       ///< cached fist multiline open
-    std::vector<Token> too_long = {}; ///< Tokens after LTL limit
-
-    string      buffer = ""; ///< current token buffer
-    Token::Type t;           ///< current Token type
-    for (uint32 i = 0; i < text.size(); i++) {
+    Token                     ml_open      = current.ml_open;
+    uint32                    buffer_start = current.buffer_start;
+    uint32                    buffer_len   = current.buffer_len;
+    vector<Token>&            tokens       = this->tokens;
+    vector<Token>&            too_long     = this->too_long;
+    vector<NumericLiteral>*   literals     = this->literals;
+    vector<function<void()>>* deferred     = this->deferred;
+    Token::Type               t; ///< current Token type
+    uint32                    i         = this->i;
+    usize                     batch_end = tokens.size() + batch_size;
+    for (; i < text.size() and tokens.size() < batch_end; i++) {
         // update variables
         char c = text[i];
-        col++;
-        if (c != '\n') {
-            *lc += c; // add char to line buffer
-        }
 
-        if (line_comment) { goto update; } // ignore rest of line
+        if (line_comment) { // ignore rest of line
+            if (fast_scan and c != '\n') {
+                i = scan::findAny<'\n'>(text, i) - 1;
+                continue;
+            }
+            goto update;
+        }
+        if (fast_scan and (delimiter(c)) and ml_comment == NO_COMMENT and not in_string and not in_char) {
+            handleBuffer();
+            uint32 blank_end = scan::skipAll<' ', '\t', '\n'>(text, i);
+            // only the last line break of the run matters to line bookkeeping
+            for (uint32 j = blank_end; j > i; j--) {
+                if (text[j - 1] == '\n') {
+                    i = j - 1;
+                    c = '\n';
+                    break;
+                }
+            }
+            updateVars();
+            i = blank_end - 1;
+            continue;
+        }
 
         // comments
         if (c == '/' and i < text.size() - 1 and text[i + 1] == '/') { // Single line comment
@@ -260,28 +482,32 @@ lexer::TokenStream lexer::tokenize(string text, string filename) {
             handleBuffer();
             ml_comment++;
             if (ml_comment == 1) {
-                ml_open =
-                    Token(Token::Type::NONE, "/*", line, col, make_shared<string>(filename), lc); // cache opening token
+                ml_open = Token(Token::Type::NONE, &source, i, 2); // cache opening token
             }
             goto update;
         }
         if (c == '*' and i < text.size() - 1 and text[i + 1] == '/') {
-            *lc += '/';
+            if (not in_string and not in_char) { handleBuffer(); }
             if (ml_comment == NO_COMMENT) {
-                parser::error(parser::errors["Unopened multiline comment"],
-                              {Token(Token::Type::NONE, "*/", line, col, make_shared<string>(filename), lc)},
-                              "This multiline comment was never opened");
+                report(parser::error(parser::errors["Unopened multiline comment"],
+                                     {Token(Token::Type::NONE, &source, i, 2)},
+                                     "This multiline comment was never opened"));
             }
             ml_comment -= ml_comment > NO_COMMENT ? 1 : 0; // make sure ml_comment doesn't underflow
             i++;
-            col++;
             goto update;
         }
-        if (ml_comment > NO_COMMENT) { goto update; } // => in multiline_comment
+        if (ml_comment > NO_COMMENT) { // => in multiline_comment
+            if (fast_scan and c != '\n') {
+                i = scan::findAny<'/', '*', '\n'>(text, i + 1) - 1;
+                continue;
+            }
+            goto update;
+        }
         if (c == '"') {
             if (i == 0 or text[i] != '\\') {
                 in_string = not in_string;
-                buffer += c;
+                addToBuffer();
                 if (not in_string) { handleBuffer(); }
                 goto update;
             }
@@ -289,34 +515,37 @@ lexer::TokenStream lexer::tokenize(string text, string filename) {
         if (c == '\'') {
             if (i == 0 or text[i] != '\\') {
                 in_char = not in_char;
-                buffer += c;
+                addToBuffer();
                 if (not in_char) { handleBuffer(); }
                 goto update;
             }
         }
         if (in_string or in_char) { // => in char or string literal
-            buffer += c;
+            addToBuffer();
+            if (fast_scan and c != '\n') {
+                i = scan::findAny<'/', '*', '"', '\'', '\n'>(text, i + 1) - 1;
+                addToBuffer();
+            }
             goto update;
         }
 
         // Special Error: unresolved Git merge conflict
-        if (c == '<' and text.size() >= i + 12 and text.substr(i, 13) == "<<<<<<<< HEAD") {
-            *lc += "<<<<<<< HEAD"; // Add to line buffer
-            parser::error(
+        if (c == '<' and text.compare(i, 13, "<<<<<<<< HEAD") == 0) {
+            handleBuffer();
+            report(parser::error(
                 parser::errors["Unresolved merge conflict"],
-                {Token(lexer::Token::Type::NONE, "<<<<<<<< HEAD", line, col, make_shared<string>(filename), lc)},
+                {Token(lexer::Token::Type::NONE, &source, i, 13)},
                 "There is an unresolved git merge conflict in this file.\nTry\n \e[36m$\e[0m git mergetool\nfor "
-                "help");
-            while (!std::regex_match(*lc, std::regex(">>>>>>> .*"))) { // move fwd until merge conflict end
+                "help"));
+            // move fwd until merge conflict end
+            while (i - line_start < 7 or text.compare(line_start, 8, ">>>>>>> ") != 0) {
                 i++;
-                col++;
+                if (i >= text.size()) { goto abort; }
                 c = text[i];
-                if (i >= text.size()) { return TokenStream({}); }
                 updateVars();
             }
             while (i + 1 < text.size() and text[i + 1] != '\n') {
                 i++;
-                col++;
                 c = text[i];
                 updateVars()
             }
@@ -326,23 +555,19 @@ lexer::TokenStream lexer::tokenize(string text, string filename) {
         if (i < text.size() - 2) {
             if (c == '.' and text[i + 1] == '.' and text[i + 2] == '.') {
                 handleBuffer();
-                tokens->push_back(Token(Token::Type::DOTDOTDOT, "...", line, col, make_shared<string>(filename), lc));
-                col += 2;
-                i   += 2;
-                *lc += text.substr(i, 2);
+                tokens.push_back(Token(Token::Type::DOTDOTDOT, &source, i, 3));
+                i += 2;
                 goto update;
             }
         }
 
         // Double delimiter Tokens (ex. ++, .., <<)
         if (i < text.size() - 1) {
-            t = getDoubleToken(""s + c + text[i + 1]);
+            t = getDoubleToken(string_view(text).substr(i, 2));
             if (t != Token::Type::NONE) {
                 handleBuffer();
-                tokens->push_back(Token(t, ""s + c + text[i + 1], line, col, make_shared<string>(filename), lc));
-                col++;
-                i   += 1;
-                *lc += text[i];
+                tokens.push_back(Token(t, &source, i, 2));
+                i += 1;
                 goto update;
             }
         }
@@ -351,27 +576,271 @@ lexer::TokenStream lexer::tokenize(string text, string filename) {
         t = getSingleToken(c);
         if (t != Token::Type::NONE) {
             handleBuffer();
-            tokens->push_back(Token(t, ""s + c, line, col, make_shared<string>(filename), lc));
+            tokens.push_back(Token(t, &source, i, 1));
             goto update;
         }
 
         if (delimiter(c)) {
             handleBuffer();
         } else {
-            buffer += c;
+            addToBuffer();
         }
 update:
         updateVars();
     }
-    handleBuffer();
-    if (ml_comment > NO_COMMENT) { // Some Multiline comment was never closed
-        parser::warn(parser::warnings["Unclosed multiline comment"],
-                     {ml_open},
-                     "This multiline comment was never closed. This could cause problems with commented code");
+    if (i >= text.size()) {
+        if (text.size() == source.text.size()) { handleBuffer(); }
+        done = true;
+    }
+    goto save;
+abort:
+    tokens.clear();
+    open.clear();
+    matched     = 0;
+    released    = 0;
+    done        = true;
+    was_aborted = true;
+save:
+    this->i            = i;
+    this->line_start   = line_start;
+    this->line_comment = line_comment;
+    current            = {in_string, in_char, ml_comment, ml_open, buffer_start, buffer_len};
+}
+
+void lexer::Lexer::matchBrackets() {
+    if (not whole_source) { // chunks can not see the brackets around them
+        matched = released = tokens.size();
+        return;
+    }
+    for (; matched < tokens.size(); matched++) {
+        Token& t = tokens[matched];
+        if (opensGroup(t.type)) {
+            open.push_back(matched);
+        } else if (closesGroup(t.type)) {
+            if (open.empty()) {
+                parser::error(parser::errors["Unopened bracket"],
+                              {t},
+                              "This '"_s + to_string(t.type) + "' closes a bracket that was never opened");
+                continue;
+            }
+            Token& partner = tokens[open.back()];
+            if (closingOf(partner.type) != t.type) {
+                parser::error(parser::errors["Mismatched bracket"],
+                              {t},
+                              "Expected '"_s + to_string(closingOf(partner.type)) + "', found '" + to_string(t.type) + "'");
+                parser::note({partner}, "to match this '"_s + to_string(partner.type) + "'");
+            }
+            t.partner = partner.partner = matched - open.back();
+            open.pop_back();
+        }
     }
-    if (tokens->size() == 0) { // Empty file warning
-        std::cerr << "\r\e[1;33mWARNING:\e[0m\e[1m " << filename << "\e[0m appears to be empty.\n";
+    if (done) {
+        for (uint32 o : open) {
+            parser::error(parser::errors["Unclosed bracket"],
+                          {tokens[o]},
+                          "This '"_s + to_string(tokens[o].type) + "' is never closed");
+        }
+        open.clear();
     }
+    released = open.empty() ? tokens.size() : open.front();
+}
+
+void lexer::Lexer::lexParallel() {
+    struct Chunk {
+            uint32                   begin;
+            uint32                   end;
+            LexState                 finish      = {};
+            vector<Token>            tokens      = {};
+            vector<NumericLiteral>   literals    = {};
+            vector<function<void()>> diagnostics = {};
+    };
+
+    auto lexChunk = [this](Chunk& chunk, LexState state) {
+        Lexer lexer(source, chunk.begin, chunk.end, state, &chunk.literals, &chunk.diagnostics);
+        lexer.pretty_size = pretty_size; // chunks are lexed on workers, which do not work for the session
+        Token token;
+        while (lexer.next(token)) { chunk.tokens.push_back(token); }
+        chunk.finish = lexer.state();
+        return not lexer.aborted();
+    };
+
+    vector<Chunk> chunks = {};
+    for (uint32 begin = 0; begin < text.size();) {
+        usize end = text.find('\n', std::min<usize>(begin + chunk_size, text.size()));
+        end       = end == string::npos ? text.size() : end + 1;
+        chunks.push_back({begin, (uint32) end});
+        begin = end;
+    }
+
+    // every chunk assumes it starts outside of any comment, string or char
+    ThreadPool::shared().parallelFor(chunks.size(), [&](usize c) { lexChunk(chunks[c], LexState()); });
+
+    for (Chunk& chunk : chunks) {
+        if (not(current == LexState())) { // assumption was wrong, lex again from the real state
+            chunk.tokens.clear();
+            chunk.literals.clear();
+            chunk.diagnostics.clear();
+            if (not lexChunk(chunk, current)) {
+                tokens.clear();
+                was_aborted = true;
+                break;
+            }
+        }
+        for (function<void()>& diagnostic : chunk.diagnostics) { diagnostic(); }
+        // literal indices are local to the chunk
+        uint32 literal_base = literals->size();
+        for (Token& token : chunk.tokens) {
+            if (token.literal != 0) { token.literal += literal_base; }
+        }
+        literals->insert(literals->end(), chunk.literals.begin(), chunk.literals.end());
+        tokens.insert(tokens.end(), chunk.tokens.begin(), chunk.tokens.end());
+        current = chunk.finish;
+    }
+    i    = text.size();
+    done = true;
+}
+
+/// \brief get a list of tokens from a source.
+/// Might issue warnings that defer further processing.
+///
+/// \return Vector of Tokens tokenized.
+lexer::TokenStream lexer::tokenize(Source& source) {
+    sptr<std::vector<lexer::Token>> tokens =
+        sptr<std::vector<lexer::Token>>(new std::vector<lexer::Token>({})); ///< output Token vector
+    Lexer lexer(source);
+    Token token;
+    while (lexer.next(token)) { tokens->push_back(token); }
+    if (lexer.aborted()) { return TokenStream({}); }
 
     return TokenStream(tokens, 0, tokens->size());
 }
+
+TEST_CASE ("Testing lexer::scan", "[lexer]") {
+    string text = "    \t\n  abc" + string(40, ' ') + "x/*" + string(20, 'y') + "\"";
+
+    REQUIRE((lexer::scan::skipAll<' ', '\t', '\n'>(text, 0)) == 8);
+    REQUIRE((lexer::scan::skipAll<' ', '\t', '\n'>(text, 11)) == 51);
+    REQUIRE((lexer::scan::findAny<'/', '*', '"'>(text, 0)) == 52);
+    REQUIRE((lexer::scan::findAny<'"'>(text, 0)) == text.size() - 1);
+    REQUIRE((lexer::scan::findAny<'#'>(text, 3)) == text.size());
+    REQUIRE((lexer::scan::skipAll<'y'>(text, 54)) == text.size() - 1);
+}
+
+/// \brief build lexer input from fragments hitting all of the fast paths
+///
+string randomLexerInput(uint32 seed, usize fragment_count) {
+    const string fragments[] = {"a",           "bc_d",         "12",          "0x1f",        " ",
+                                "\t",          "\n",           "        ",     "\n\n    \t ", "// c /* x\n",
+                                "/* c \n */",  "/*/**/*/",     "\"s t /r\"",   "'c'",         "\"it's\"",
+                                "+",           "<<",           "...",          ";",           "(",
+                                ")",           "{",            "}",            "include",     "a.b",
+                                "\"multi\nline\"", "'\n'"};
+    std::mt19937 rng(seed);
+    string       out;
+    for (usize i = 0; i < fragment_count; i++) { out += fragments[rng() % std::size(fragments)]; }
+    return out;
+}
+
+TEST_CASE ("Testing lexer::tokenize fast scan against the scalar lexer", "[lexer]") {
+    CompilationSession        session;
+    CompilationSession::Scope scope(session);
+    session.pretty_size = -1; // random lines get long
+    parser::mute();           // and brackets unbalanced
+    for (uint32 seed = 1; seed < 40; seed++) {
+        string text = randomLexerInput(seed, 200);
+
+        lexer::fast_scan         = false;
+        lexer::TokenStream plain = lexer::tokenize(text);
+        lexer::fast_scan         = true;
+        lexer::TokenStream fast  = lexer::tokenize(text);
+
+        REQUIRE(plain.size() == fast.size());
+        for (usize i = 0; i < plain.size(); i++) {
+            REQUIRE(plain[i].type == fast[i].type);
+            REQUIRE(plain[i].offset == fast[i].offset);
+            REQUIRE(plain[i].length == fast[i].length);
+            REQUIRE(plain[i].line() == fast[i].line());
+        }
+    }
+}
+
+TEST_CASE ("Testing lexer::tokenize in parallel against the serial lexer", "[lexer]") {
+    CompilationSession        session;
+    CompilationSession::Scope scope(session);
+    session.pretty_size = -1;
+    parser::mute();
+    for (uint32 seed = 1; seed < 40; seed++) {
+        string text = randomLexerInput(seed, 400);
+
+        lexer::parallel_threshold = -1;
+        lexer::TokenStream serial = lexer::tokenize(text);
+        lexer::parallel_threshold = 0;
+        lexer::chunk_size         = 1 + seed * 7; // small chunks, so strings and comments span them
+        lexer::TokenStream chunked = lexer::tokenize(text);
+
+        REQUIRE(serial.size() == chunked.size());
+        for (usize i = 0; i < serial.size(); i++) {
+            REQUIRE(serial[i].type == chunked[i].type);
+            REQUIRE(serial[i].offset == chunked[i].offset);
+            REQUIRE(serial[i].length == chunked[i].length);
+            REQUIRE(serial[i].partner == chunked[i].partner);
+        }
+    }
+    lexer::parallel_threshold = 4 * 1024 * 1024;
+    lexer::chunk_size         = 512 * 1024;
+}
+
+TEST_CASE ("Testing lexer::Lexer bracket matching", "[lexer]") {
+    CompilationSession        session;
+    CompilationSession::Scope scope(session);
+    parser::mute();
+    lexer::TokenStream tokens = lexer::tokenize("f(a[1], {b}) (c");
+
+    REQUIRE(tokens[1].partner == 9); // ( ... )
+    REQUIRE(tokens[10].partner == 9);
+    REQUIRE(tokens[3].partner == 2); // [1]
+    REQUIRE(tokens[5].partner == 2);
+    REQUIRE(tokens[7].partner == 2); // {b}
+    REQUIRE(tokens[11].partner == 0); // never closed
+
+    uint64 errors = session.errc;
+    lexer::tokenize("(a])");
+    REQUIRE(session.errc - errors == 2); // mismatched and unopened
+    errors = session.errc;
+    lexer::tokenize("{ ( }");
+    REQUIRE(session.errc - errors == 2); // mismatched and unclosed
+
+    // tokens in a group are only pulled once it is closed
+    lexer::Lexer lexer(lexer::SourceManager::current().add("test.cst", "a { b } c"));
+    lexer::Token token;
+    while (lexer.next(token) and token.type != lexer::Token::BLOCK_OPEN) {}
+    REQUIRE(token.partner == 2);
+}
+
+#ifdef CATCH2
+TEST_CASE ("Benchmarking lexer::tokenize", "[.benchmark][lexer]") {
+    string                    text = randomLexerInput(7, 200'000);
+    CompilationSession        session;
+    CompilationSession::Scope scope(session);
+    session.pretty_size = -1;
+    parser::mute();
+
+    auto throughput = [&]() {
+        auto    start   = std::chrono::steady_clock::now();
+        usize   found   = lexer::tokenize(text).size();
+        float64 seconds = std::chrono::duration<float64>(std::chrono::steady_clock::now() - start).count();
+        FORGET(found);
+        return float64(text.size()) / seconds / 1e6;
+    };
+
+    lexer::fast_scan          = false;
+    float64 plain             = throughput();
+    lexer::fast_scan          = true;
+    float64 fast              = throughput();
+    lexer::parallel_threshold = 0;
+    float64 parallel          = throughput();
+    WARN ("lexer::tokenize: " << fast << " MB/s, without fast scan: " << plain << " MB/s, in parallel: " << parallel
+                              << " MB/s");
+    lexer::parallel_threshold = 4 * 1024 * 1024;
+}
+#endif
@@ -2,14 +2,123 @@
 #include "../snippets.hpp"
 #include "token.hpp"
 
+#include <functional>
+#include <string_view>
+#include <vector>
+
 namespace lexer {
 
-    extern int32 pretty_size; ///< max length before LTL warning
+    extern bool fast_scan; ///< skip whitespace, comments and literals in blocks. Only disabled in tests
 
-    /// \brief get a list of tokens from a string.
+    extern usize parallel_threshold; ///< sources from this size on are lexed in parallel. Only changed in tests
+    extern usize chunk_size;         ///< approximate size of the chunks lexed in parallel
+
+    ///
+    /// \brief state of the lexer at a line start, carried over from one chunk into the next
+    ///
+    struct LexState {
+            bool   in_string    = false; ///< if in a string
+            bool   in_char      = false; ///< if in a char
+            uint64 ml_comment   = 0;     ///< multiline comment level. If 0 => no comment
+            Token  ml_open;              ///< cached fist multiline open
+            uint32 buffer_start = 0;     ///< start of the current token buffer in text
+            uint32 buffer_len   = 0;     ///< length of the current token buffer
+
+            /// \brief check if lexing from both states gives the same tokens
+            bool operator==(const LexState& other) const {
+                return in_string == other.in_string and in_char == other.in_char and ml_comment == other.ml_comment and
+                       buffer_len == other.buffer_len and (buffer_len == 0 or buffer_start == other.buffer_start);
+            }
+    };
+
+    ///
+    /// \brief pull-based lexer, tokens are lexed in small batches as they are requested.
+    ///
+    /// Sources bigger than lexer::parallel_threshold are lexed in parallel up front instead.
+    /// Brackets of a whole source are matched (\see Token::partner), so tokens inside a group are only
+    /// handed out once the group is closed.
+    ///
+    class Lexer final {
+            static constexpr usize batch_size = 1024; ///< tokens lexed at once
+
+            Source&       source;
+            string_view   text;                 ///< source text up to the end of the lexed range
+            uint32        i            = 0;     ///< current index in text
+            uint64        line_start   = 0;     ///< index of the current lines start
+            bool          line_comment = false; ///< if currently in a line comment
+            LexState      current      = {};
+            int32         pretty_size;          ///< max line length before LTL warning, of the lexer's session
+            vector<Token> too_long     = {};    ///< Tokens after LTL limit
+
+            vector<Token>  tokens   = {}; ///< lexed tokens that were not pulled yet
+            usize          pulled   = 0;  ///< index of the next token to pull in tokens
+            usize          released = 0;  ///< tokens before this index may be pulled, their brackets are matched
+            usize          matched  = 0;  ///< tokens before this index went through matchBrackets
+            usize          count    = 0;  ///< tokens pulled in total
+            vector<uint32> open     = {}; ///< indices of the brackets in tokens waiting for their partner
+
+            vector<NumericLiteral>*   literals     = nullptr; ///< decoded numeric literals are added here
+            vector<function<void()>>* deferred     = nullptr; ///< diagnostics are collected here if given
+            bool                      whole_source = true;    ///< if this lexes a whole source (and not a chunk)
+            bool                      done         = false;   ///< if the end of the range was reached
+            bool                      was_aborted  = false;   ///< if lexing stopped early
+            float64                   seconds      = 0;       ///< time spent lexing
+
+            /// \brief lex the next batch of tokens
+            void lexSome();
+
+            /// \brief match the brackets of the newly lexed tokens and release the tokens that are not in an open group
+            ///
+            /// Unbalanced brackets are reported here, once per source.
+            void matchBrackets();
+
+            /// \brief lex the whole source in parallel chunks into tokens
+            void lexParallel();
+
+        public:
+            /// \brief lex a whole source
+            Lexer(Source& source);
+
+            ///
+            /// \brief lex a chunk of a source. The chunk has to start at a line start.
+            /// The buffer is only flushed at the end of the source.
+            ///
+            /// \param state    state at begin
+            /// \param literals decoded numeric literals are added there, tokens index into it
+            /// \param deferred if given, diagnostics are stored there instead of issued
+            ///
+            Lexer(Source&                   source,
+                  uint32                    begin,
+                  uint32                    end,
+                  LexState                  state,
+                  vector<NumericLiteral>*   literals,
+                  vector<function<void()>>* deferred);
+
+            /// \brief get the next token
+            ///
+            /// \return false if there are no more tokens
+            bool next(Token& token);
+
+            /// \brief check if lexing stopped because of an unrecoverable error
+            bool aborted() const { return was_aborted; }
+
+            /// \brief get the state after the last lexed char
+            LexState state() const { return current; }
+
+            /// \brief get the time spent lexing so far in seconds, without the time the tokens were waited for
+            float64 time() const { return seconds; }
+    };
+
+    /// \brief get a list of tokens from a source.
     /// Might issue warnings that defer further processing.
     ///
     /// \return Vector of Tokens tokenized.
+    extern TokenStream tokenize(Source& source);
+
+    /// \brief get a list of tokens from a string.
+    /// The text is added to the SourceManager of the current session as a new Source.
+    ///
+    /// \return Vector of Tokens tokenized.
     extern TokenStream tokenize(string text, string filename);
     extern TokenStream tokenize(string text);
 
@@ -23,13 +132,21 @@ namespace lexer {
     /// \param s string has to have length 2!
     ///
     /// \return token type found or Token::Type::NONE. \see lexer::Token::Type
-    extern Token::Type getDoubleToken(string s);
+    extern Token::Type getDoubleToken(string_view s);
 
     /// \brief try to find the token type of a token that does not fit getSingleToken or getDoubleToken
     ///
     /// \param c string buffer
     ///
     /// \return token type found or Token::Type::NONE. \see lexer::Token::Type
-    extern Token::Type matchType(string c);
+    extern Token::Type matchType(string_view c);
+
+    /// \brief decode the value of a numeric literal
+    ///
+    /// \param c    literal text, including the `0x` or `0b` prefix
+    /// \param type Token::INT, Token::HEX or Token::BINARY
+    ///
+    /// \return the value, or 0 for other token types
+    extern NumericLiteral decodeNumber(string_view c, Token::Type type);
 
 } // namespace lexer
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+//
+// SCAN.hpp
+//
+// vectorized helpers the lexer uses to skip over runs of uninteresting chars
+//
+
+#include "../snippets.hpp"
+
+#include <bit>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace lexer::scan {
+
+    ///
+    /// \brief find the first char at or after `from` that is (`match` = true) or is not (`match` = false) one of `cs`
+    ///
+    /// Uses AVX2 (32 bytes) and SSE2 (16 bytes) blocks where the target supports them and finishes with a
+    /// scalar tail.
+    ///
+    /// \return index of that char or `text.size()` if there is none
+    template <bool match, char... cs> inline usize scanFor(string_view text, usize from) {
+        const char* begin = text.data();
+        const char* end   = begin + text.size();
+        const char* p     = begin + from;
+#if defined(__AVX2__)
+        for (; end - p >= 32; p += 32) {
+            __m256i block = _mm256_loadu_si256((const __m256i*) p);
+            __m256i hits  = _mm256_setzero_si256();
+            ((hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(cs)))), ...);
+            uint32 bits = (uint32) _mm256_movemask_epi8(hits);
+            if constexpr (!match) { bits = ~bits; }
+            if (bits != 0) { return p - begin + std::countr_zero(bits); }
+        }
+#endif
+#if defined(__SSE2__)
+        for (; end - p >= 16; p += 16) {
+            __m128i block = _mm_loadu_si128((const __m128i*) p);
+            __m128i hits  = _mm_setzero_si128();
+            ((hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(cs)))), ...);
+            uint32 bits = (uint32) _mm_movemask_epi8(hits);
+            if constexpr (!match) { bits = ~bits & 0xFFFF; }
+            if (bits != 0) { return p - begin + std::countr_zero(bits); }
+        }
+#endif
+        for (; p < end; p++) {
+            if (((*p == cs) or ...) == match) { return p - begin; }
+        }
+        return text.size();
+    }
+
+    /// \brief find the first of `cs` at or after `from`
+    ///
+    /// \return index of that char or `text.size()` if there is none
+    template <char... cs> inline usize findAny(string_view text, usize from) { return scanFor<true, cs...>(text, from); }
+
+    /// \brief skip all of `cs` starting at `from`
+    ///
+    /// \return index of the first other char or `text.size()` if there is none
+    template <char... cs> inline usize skipAll(string_view text, usize from) { return scanFor<false, cs...>(text, from); }
+
+} // namespace lexer::scan
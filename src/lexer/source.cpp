@@ -0,0 +1,198 @@
+#include "source.hpp"
+
+#include "../session.hpp"
+#include "../snippets.hpp"
+#include "token.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+/// \brief files smaller than this are read instead of mapped, mapping them costs more than copying
+///
+constexpr usize min_mapping_size = 16 * 1024;
+
+lexer::Source::Source(uint32 id, string name, string text) : owned(std::move(text)), id(id), name(std::move(name)) {
+    this->text = owned;
+    indexLines();
+}
+
+lexer::Source::Source(uint32 id, string name) : id(id), name(std::move(name)) {
+    int fd = open(this->name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        indexLines();
+        return;
+    }
+    struct stat info;
+    bool        regular = fstat(fd, &info) == 0 and S_ISREG(info.st_mode);
+    if (regular) { mtime = (int64) info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec; }
+    if (regular and (usize) info.st_size >= min_mapping_size) {
+        void* map = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, info.st_size, MADV_SEQUENTIAL);
+            mapping      = map;
+            mapping_size = info.st_size;
+            text         = string_view((const char*) map, info.st_size);
+        }
+    }
+    if (mapping == nullptr) { // small files, pipes and stdin
+        if (regular) { owned.reserve(info.st_size); }
+        char    buffer[64 * 1024];
+        ssize_t n;
+        while ((n = read(fd, buffer, sizeof(buffer))) > 0) { owned.append(buffer, n); }
+        text = owned;
+    }
+    close(fd);
+    indexLines();
+}
+
+lexer::Source::~Source() {
+    if (mapping != nullptr) { munmap(mapping, mapping_size); }
+}
+
+void lexer::Source::indexLines() {
+    line_starts.push_back(0);
+    const char* begin = text.data();
+    const char* end   = begin + text.size();
+    for (const char* c = begin; (c = (const char*) memchr(c, '\n', end - c)) != nullptr; c++) {
+        line_starts.push_back(c - begin + 1);
+    }
+}
+
+uint32 lexer::Source::lineOf(uint32 offset) const {
+    return upper_bound(line_starts.begin(), line_starts.end(), offset) - line_starts.begin();
+}
+
+uint32 lexer::Source::lineStart(uint32 line) const {
+    if (line == 0 or line > line_starts.size()) { return text.size(); }
+    return line_starts[line - 1];
+}
+
+string_view lexer::Source::lineContents(uint32 line) const {
+    if (line == 0 or line > line_starts.size()) { return ""; }
+    uint32 start = line_starts[line - 1];
+    uint32 end   = line < line_starts.size() ? line_starts[line] - 1 : text.size();
+    return string_view(text).substr(start, end - start);
+}
+
+TEST_CASE ("Testing lexer::Source line index", "[tokens]") {
+    lexer::Source source(0, "test.cst", "a\n  bc\n\nd");
+
+    REQUIRE(source.lineCount() == 4);
+    REQUIRE(source.lineOf(0) == 1);
+    REQUIRE(source.lineOf(1) == 1);
+    REQUIRE(source.lineOf(2) == 2);
+    REQUIRE(source.lineOf(7) == 3);
+    REQUIRE(source.lineOf(8) == 4);
+    REQUIRE(source.lineStart(2) == 2);
+    REQUIRE(source.lineContents(1) == "a");
+    REQUIRE(source.lineContents(2) == "  bc");
+    REQUIRE(source.lineContents(3) == "");
+    REQUIRE(source.lineContents(4) == "d");
+    REQUIRE(source.lineContents(5) == "");
+}
+
+lexer::Source& lexer::SourceManager::add(string name, string text) {
+    lock_guard<mutex> guard(lock);
+    uint32            id = next_id++;
+    return *(sources[id] = make_unique<Source>(id, std::move(name), std::move(text)));
+}
+
+lexer::Source& lexer::SourceManager::load(string name) {
+    lock_guard<mutex> guard(lock);
+    uint32            id = next_id++;
+    return *(sources[id] = make_unique<Source>(id, std::move(name)));
+}
+
+vector<lexer::Token>* lexer::SourceManager::keep(sptr<vector<Token>> tokens) {
+    lock_guard<mutex> guard(lock);
+    vector<Token>*    kept = tokens.get();
+    this->tokens.emplace(kept, std::move(tokens));
+    return kept;
+}
+
+void lexer::SourceManager::release(const Source& source) {
+    lock_guard<mutex> guard(lock);
+    auto              entry = sources.find(source.id);
+    if (entry == sources.end() or entry->second.get() != &source) { return; }
+    if (source.included_from != nullptr) { tokens.erase(source.included_from->tokens); }
+    sources.erase(entry);
+}
+
+void lexer::SourceManager::release(const vector<Token>* tokens) {
+    lock_guard<mutex> guard(lock);
+    this->tokens.erase(tokens);
+}
+
+void lexer::SourceManager::clear() {
+    lock_guard<mutex> guard(lock);
+    tokens.clear();
+    sources.clear();
+}
+
+const lexer::Source& lexer::SourceManager::operator[](uint32 id) const {
+    lock_guard<mutex> guard(lock);
+    return *sources.at(id);
+}
+
+usize lexer::SourceManager::size() const {
+    lock_guard<mutex> guard(lock);
+    return sources.size();
+}
+
+usize lexer::SourceManager::keptTokens() const {
+    lock_guard<mutex> guard(lock);
+    return tokens.size();
+}
+
+lexer::SourceManager& lexer::SourceManager::current() {
+    return CompilationSession::current().source_manager;
+}
+
+TEST_CASE ("Testing lexer::SourceManager", "[tokens]") {
+    lexer::SourceManager manager;
+    lexer::Source&       a = manager.add("a.cst", "a");
+    lexer::Source&       b = manager.add("b.cst", "b");
+
+    REQUIRE(manager.size() == 2);
+    REQUIRE(a.id == 0);
+    REQUIRE(b.id == 1);
+    REQUIRE(&manager[0] == &a);
+    REQUIRE(manager[1].name == "b.cst");
+
+    // released sources take the tokens of their include statement with them, ids are not reused
+    sptr<vector<lexer::Token>> included = make_shared<vector<lexer::Token>>(2);
+    b.included_from                     = make_shared<lexer::TokenStream>(*included);
+    REQUIRE(manager.keep(included) == included.get());
+    REQUIRE(manager.keptTokens() == 1);
+    manager.release(b);
+    REQUIRE(manager.size() == 1);
+    REQUIRE(manager.keptTokens() == 0);
+    REQUIRE(manager.add("c.cst", "c").id == 2);
+    manager.clear();
+    REQUIRE(manager.size() == 0);
+}
+
+TEST_CASE ("Testing lexer::SourceManager::load", "[tokens]") {
+    lexer::SourceManager manager;
+    string               small = "a\nb";
+    string               big   = string(64 * 1024, 'x') + "\ny";
+    string               path  = (filesystem::temp_directory_path() / "cstc_source_test.cst").string();
+
+    for (const string& contents : {small, big}) {
+        ofstream(path) << contents;
+        const lexer::Source& source = manager.load(path);
+        REQUIRE(source.text == contents);
+        REQUIRE(source.lineCount() == 2);
+        REQUIRE(source.lineContents(2) == contents.substr(contents.size() - 1));
+    }
+    filesystem::remove(path);
+    REQUIRE(manager.load(path).text == "");
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+//
+// SOURCE.hpp
+//
+// layouts the source buffers tokens point into and the manager owning them
+//
+
+#include "../snippets.hpp"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace lexer {
+
+    class Token;
+    class TokenStream;
+
+    ///
+    /// \brief value of a numeric literal, decoded once by the lexer
+    ///
+    struct NumericLiteral {
+            uint128 value    = 0;     ///< value of the literal, wrapped if it overflowed
+            bool    overflow = false; ///< if the literal does not fit into 128 bits
+    };
+
+    ///
+    /// \brief holds the contents of a source file.
+    ///
+    /// Tokens only store their position in a Source, so it has to stay alive
+    /// (and unmodified) for as long as its tokens are used. Sources are owned by the SourceManager.
+    /// The contents are either a read-only mapping of the file or a string owned by the Source.
+    ///
+    class Source final {
+            vector<uint32> line_starts  = {};      ///< offset of the first char of every line
+            string         owned        = "";      ///< contents, if they are not mapped
+            void*          mapping      = nullptr; ///< mmap-ed file contents
+            usize          mapping_size = 0;       ///< size of the mapping
+
+            void indexLines();
+
+        public:
+            uint32      id;         ///< index of this source in its SourceManager
+            string      name;       ///< file name
+            string_view text;       ///< file contents
+            int64       mtime = -1; ///< modification time (ns) of the file when it was read, -1 if not read from a file
+
+            sptr<TokenStream> included_from = nullptr; ///< `include` statement this source was included by
+
+            vector<NumericLiteral> literals = {}; ///< decoded numeric literals, tokens reference them by index
+
+            /// \brief create a source from a string
+            Source(uint32 id, string name, string text);
+
+            /// \brief create a source from a file. Mapped if it is big enough, read otherwise.
+            /// A file that can not be opened results in an empty source
+            Source(uint32 id, string name);
+
+            Source(const Source&)            = delete;
+            Source& operator=(const Source&) = delete;
+            ~Source();
+
+            /// \brief get the line (starting at 1) an offset is in
+            uint32 lineOf(uint32 offset) const;
+
+            /// \brief get the offset of the first char of a line (starting at 1)
+            uint32 lineStart(uint32 line) const;
+
+            /// \brief get the contents of a line (starting at 1) without its line break
+            string_view lineContents(uint32 line) const;
+
+            /// \brief get the number of lines in this source
+            uint32 lineCount() const { return line_starts.size(); }
+    };
+
+    ///
+    /// \brief owns the Sources of a compilation and assigns their file ids.
+    ///
+    /// Sources never move once added, so references and Token pointers into them stay valid until they are released.
+    /// The token vectors lexed from them are kept here as well, so TokenStreams can be plain views.
+    /// Every CompilationSession has its own manager, modules release their sources when they are read again or
+    /// forgotten.
+    ///
+    class SourceManager final {
+            map<uint32, uptr<Source>>                      sources = {};
+            map<const vector<Token>*, sptr<vector<Token>>> tokens  = {};
+            uint32                                         next_id = 0;
+            mutable mutex                                  lock;
+
+        public:
+            /// \brief add a new source from a string
+            ///
+            /// \return the source, which stays valid until it is released
+            Source& add(string name, string text);
+
+            /// \brief add a new source by loading a file
+            ///
+            /// \return the source, which stays valid until it is released
+            Source& load(string name);
+
+            /// \brief keep a token vector alive until it is released. Keeping a vector again does not add it twice
+            ///
+            /// \return the vector
+            vector<Token>* keep(sptr<vector<Token>> tokens);
+
+            /// \brief free a source, along with the tokens of the `include` statement it was included by
+            void release(const Source& source);
+
+            /// \brief free a token vector kept by keep(), unknown vectors are ignored
+            void release(const vector<Token>* tokens);
+
+            /// \brief free every source and token vector
+            void clear();
+
+            /// \brief get a source by its id
+            const Source& operator[](uint32 id) const;
+
+            /// \brief get the number of sources that were not released
+            usize size() const;
+
+            /// \brief get the number of token vectors that were not released
+            usize keptTokens() const;
+
+            /// \brief get the manager of the current CompilationSession
+            static SourceManager& current();
+    };
+
+} // namespace lexer
@@ -0,0 +1,234 @@
+#pragma once
+
+//
+// SPELLING.hpp
+//
+// the single table of keyword and operator spellings
+//
+
+#include "../snippets.hpp"
+#include "token.hpp"
+
+#include <array>
+#include <string_view>
+
+namespace lexer {
+
+    ///
+    /// \brief a spelling of a Token::Type
+    ///
+    struct Spelling {
+            /// \brief what a spelling is used for
+            enum Kind : uint8 {
+                KEYWORD  = 1, ///< recognized as a keyword by lexer::matchType
+                OPERATOR = 2, ///< recognized as a delimiter by lexer::getSingleToken and lexer::getDoubleToken
+                NAME     = 4, ///< returned by to_string(Token::Type)
+            };
+
+            string_view text; ///< how it is written
+            Token::Type type; ///< what it is lexed as
+            uint8       kind; ///< combination of Kind flags
+    };
+
+    // clang-format off
+    ///
+    /// \brief all spellings known to the lexer. Adding a keyword or operator only requires a new line here.
+    ///
+    /// every Token::Type may have at most one NAME spelling.
+    ///
+    inline constexpr Spelling spellings[] = {
+            //  SPECIAL   //
+        {";"        , Token::END_CMD    , Spelling::OPERATOR | Spelling::NAME},
+
+            //  LITERALS  //
+        {"true"     , Token::BOOL       , Spelling::KEYWORD                  },
+        {"false"    , Token::BOOL       , Spelling::KEYWORD                  },
+        {"null"     , Token::NULV       , Spelling::KEYWORD  | Spelling::NAME},
+
+            //    MATH    //
+        {"="        , Token::SET        , Spelling::OPERATOR | Spelling::NAME},
+        {"+"        , Token::ADD        , Spelling::OPERATOR | Spelling::NAME},
+        {"-"        , Token::SUB        , Spelling::OPERATOR | Spelling::NAME},
+        {"*"        , Token::MUL        , Spelling::OPERATOR | Spelling::NAME},
+        {"/"        , Token::DIV        , Spelling::OPERATOR | Spelling::NAME},
+        {"%"        , Token::MOD        , Spelling::OPERATOR | Spelling::NAME},
+        {"**"       , Token::POW        , Spelling::OPERATOR | Spelling::NAME},
+        {"++"       , Token::INC        , Spelling::OPERATOR | Spelling::NAME},
+        {"--"       , Token::DEC        , Spelling::OPERATOR | Spelling::NAME},
+
+        {"~"        , Token::NEG        , Spelling::OPERATOR | Spelling::NAME},
+        {"&"        , Token::AND        , Spelling::OPERATOR | Spelling::NAME},
+        {"|"        , Token::OR         , Spelling::OPERATOR | Spelling::NAME},
+        {"^"        , Token::XOR        , Spelling::OPERATOR | Spelling::NAME},
+        {"<<"       , Token::SHL        , Spelling::OPERATOR | Spelling::NAME},
+        {">>"       , Token::SHR        , Spelling::OPERATOR | Spelling::NAME},
+        {"!>"       , Token::LSHR       , Spelling::OPERATOR                 },
+        {">>>"      , Token::LSHR       , Spelling::NAME                     },
+
+            //  LOGICAL   //
+        {"and"      , Token::LAND       , Spelling::KEYWORD  | Spelling::NAME},
+        {"or"       , Token::LOR        , Spelling::KEYWORD  | Spelling::NAME},
+        {"not"      , Token::NOT        , Spelling::KEYWORD  | Spelling::NAME},
+
+            // COMPARISON //
+        {"=="       , Token::EQ         , Spelling::OPERATOR | Spelling::NAME},
+        {"!="       , Token::NEQ        , Spelling::OPERATOR | Spelling::NAME},
+        {"<"        , Token::LT         , Spelling::OPERATOR | Spelling::NAME},
+        {">"        , Token::GT         , Spelling::OPERATOR | Spelling::NAME},
+        {">="       , Token::GEQ        , Spelling::OPERATOR | Spelling::NAME},
+        {"<="       , Token::LEQ        , Spelling::OPERATOR | Spelling::NAME},
+
+            //    FLOW    //
+        {"?"        , Token::QM         , Spelling::OPERATOR | Spelling::NAME},
+        {":"        , Token::IN         , Spelling::OPERATOR | Spelling::NAME},
+        {"<-"       , Token::UNPACK     , Spelling::OPERATOR | Spelling::NAME},
+        {"#"        , Token::REF        , Spelling::OPERATOR | Spelling::NAME},
+        {"#!"       , Token::RMREF      , Spelling::NAME                     },
+        {"&!"       , Token::RMREFT     , Spelling::NAME                     },
+
+        {"::"       , Token::SUBNS      , Spelling::OPERATOR | Spelling::NAME},
+        {"."        , Token::ACCESS     , Spelling::OPERATOR | Spelling::NAME},
+        {","        , Token::COMMA      , Spelling::OPERATOR | Spelling::NAME},
+        {".."       , Token::DOTDOT     , Spelling::OPERATOR | Spelling::NAME},
+        {"..."      , Token::DOTDOTDOT  , Spelling::NAME                     },
+
+            // PARANTHESIS //
+        {"("        , Token::OPEN       , Spelling::OPERATOR | Spelling::NAME},
+        {")"        , Token::CLOSE      , Spelling::OPERATOR | Spelling::NAME},
+        {"{"        , Token::BLOCK_OPEN , Spelling::OPERATOR | Spelling::NAME},
+        {"}"        , Token::BLOCK_CLOSE, Spelling::OPERATOR | Spelling::NAME},
+        {"["        , Token::INDEX_OPEN , Spelling::OPERATOR | Spelling::NAME},
+        {"]"        , Token::INDEX_CLOSE, Spelling::OPERATOR | Spelling::NAME},
+
+            //  KEYWORDS  //
+        {"if"       , Token::IF         , Spelling::KEYWORD  | Spelling::NAME},
+        {"else"     , Token::ELSE       , Spelling::KEYWORD  | Spelling::NAME},
+        {"for"      , Token::FOR        , Spelling::KEYWORD  | Spelling::NAME},
+        {"while"    , Token::WHILE      , Spelling::KEYWORD  | Spelling::NAME},
+        {"loop"     , Token::LOOP       , Spelling::NAME                     },
+        {"throw"    , Token::THROW      , Spelling::KEYWORD  | Spelling::NAME},
+        {"break"    , Token::BREAK      , Spelling::KEYWORD  | Spelling::NAME},
+        {"continue" , Token::CONTINUE   , Spelling::KEYWORD  | Spelling::NAME},
+        {"noimpl"   , Token::NOIMPL     , Spelling::KEYWORD  | Spelling::NAME},
+        {"return"   , Token::RETURN     , Spelling::KEYWORD  | Spelling::NAME},
+        {"as"       , Token::AS         , Spelling::KEYWORD  | Spelling::NAME},
+        {"operator" , Token::OPERATOR   , Spelling::KEYWORD  | Spelling::NAME},
+        {"switch"   , Token::SWITCH     , Spelling::KEYWORD  | Spelling::NAME},
+        {"case"     , Token::CASE       , Spelling::KEYWORD  | Spelling::NAME},
+        {"finally"  , Token::FINALLY    , Spelling::KEYWORD  | Spelling::NAME},
+        {"new"      , Token::NEW        , Spelling::KEYWORD  | Spelling::NAME},
+        {"delete"   , Token::DELETE     , Spelling::KEYWORD  | Spelling::NAME},
+
+        {"import"   , Token::IMPORT     , Spelling::KEYWORD  | Spelling::NAME},
+        {"req"      , Token::REQ        , Spelling::NAME                     },
+        {"qer"      , Token::QER        , Spelling::NAME                     },
+        {"macro"    , Token::MACRO      , Spelling::NAME                     },
+        {"include"  , Token::INCLUDE    , Spelling::KEYWORD  | Spelling::NAME},
+
+        {"class"    , Token::CLASS      , Spelling::KEYWORD  | Spelling::NAME},
+        {"enum"     , Token::ENUM       , Spelling::KEYWORD  | Spelling::NAME},
+        {"struct"   , Token::STRUCT     , Spelling::KEYWORD  | Spelling::NAME},
+        {"virtual"  , Token::VIRTUAL    , Spelling::KEYWORD  | Spelling::NAME},
+        {"abstract" , Token::ABSTRACT   , Spelling::KEYWORD  | Spelling::NAME},
+        {"final"    , Token::FINAL      , Spelling::NAME                     },
+        {"namespace", Token::NAMESPACE  , Spelling::KEYWORD  | Spelling::NAME},
+        {"friend"   , Token::FRIEND     , Spelling::NAME                     },
+        {"protected", Token::PROTECTED  , Spelling::KEYWORD  | Spelling::NAME},
+        {"private"  , Token::PRIVATE    , Spelling::KEYWORD  | Spelling::NAME},
+        {"static"   , Token::STATIC     , Spelling::KEYWORD  | Spelling::NAME},
+        {"public"   , Token::PUBLIC     , Spelling::KEYWORD  | Spelling::NAME},
+        {"mut"      , Token::MUT        , Spelling::KEYWORD  | Spelling::NAME},
+        {"const"    , Token::CONST      , Spelling::KEYWORD  | Spelling::NAME},
+        {"nowrap"   , Token::NOWRAP     , Spelling::KEYWORD  | Spelling::NAME},
+        {"x"        , Token::X          , Spelling::KEYWORD  | Spelling::NAME},
+    };
+    // clang-format on
+
+    inline constexpr usize  spelling_count      = sizeof(spellings) / sizeof(Spelling); ///< number of spellings
+    inline constexpr usize  spelling_table_size = 1024;                                 ///< hash slots, power of 2
+    inline constexpr uint8  no_spelling         = 0xFF;                                 ///< marks an empty slot
+    inline constexpr uint32 type_count          = Token::X + 1;                         ///< number of Token::Type's
+
+    static_assert(spelling_count < no_spelling, "spelling indices have to fit into a uint8");
+
+    ///
+    /// \brief seeded FNV-1a hash of a spelling, reduced to a slot of the spelling table
+    ///
+    constexpr uint32 spellingSlot(string_view text, uint32 seed) {
+        uint32 h = 2166136261u ^ seed;
+        for (char c : text) {
+            h ^= (uint8) c;
+            h *= 16777619u;
+        }
+        return (h ^ (h >> 15)) & (spelling_table_size - 1);
+    }
+
+    ///
+    /// \brief collision free hash table over spellings
+    ///
+    struct SpellingTable {
+            uint32                                 seed = 0; ///< hash seed that places every spelling in its own slot
+            std::array<uint8, spelling_table_size> slots {}; ///< index into spellings or no_spelling
+    };
+
+    ///
+    /// \brief search a seed at compile time that makes spellingSlot a perfect hash for spellings
+    ///
+    constexpr SpellingTable makeSpellingTable() {
+        SpellingTable table;
+        for (table.seed = 1; table.seed < 0x10000; table.seed++) {
+            table.slots.fill(no_spelling);
+            bool collision = false;
+            for (usize i = 0; i < spelling_count and not collision; i++) {
+                uint8& slot = table.slots[spellingSlot(spellings[i].text, table.seed)];
+                collision   = slot != no_spelling;
+                slot        = i;
+            }
+            if (not collision) { return table; }
+        }
+        table.seed = 0;
+        return table;
+    }
+
+    inline constexpr SpellingTable spelling_table = makeSpellingTable();
+    static_assert(spelling_table.seed != 0, "no perfect hash seed found, increase spelling_table_size");
+
+    ///
+    /// \brief build the Token::Type -> spelling direction
+    ///
+    constexpr std::array<string_view, type_count> makeNames() {
+        std::array<string_view, type_count> names {};
+        for (const Spelling& s : spellings) {
+            if (s.kind & Spelling::NAME) {
+                if (not names[s.type].empty()) { throw "Token::Type has two NAME spellings"; }
+                names[s.type] = s.text;
+            }
+        }
+        return names;
+    }
+
+    inline constexpr std::array<string_view, type_count> type_names = makeNames();
+
+    ///
+    /// \brief look up the type of a spelling with one hash and one compare
+    ///
+    /// \param text spelling to look up
+    /// \param kind Spelling::Kind flags the spelling has to have
+    ///
+    /// \return token type found or Token::Type::NONE
+    constexpr Token::Type lookupSpelling(string_view text, uint8 kind) {
+        uint8 idx = spelling_table.slots[spellingSlot(text, spelling_table.seed)];
+        if (idx == no_spelling) { return Token::NONE; }
+        const Spelling& s = spellings[idx];
+        return (s.kind & kind) and s.text == text ? s.type : Token::NONE;
+    }
+
+    ///
+    /// \brief get the NAME spelling of a Token::Type
+    ///
+    /// \return spelling or an empty string_view if this type has none
+    constexpr string_view typeName(Token::Type t) {
+        return (uint32) t < type_count ? type_names[t] : string_view();
+    }
+
+} // namespace lexer
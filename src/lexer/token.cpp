@@ -8,81 +8,117 @@
 // #include <iostream>
 #include "../debug.hpp"
 #include "../errors/errors.hpp"
+#include "lexer.hpp"
+#include "spelling.hpp"
 
+#include <chrono>
+#include <cstdlib>
 #include <iterator>
 #include <memory>
-#include <stack>
+#include <new>
 #include <string>
 #include <vector>
 
 using namespace std;
 
-/// \brief construct a token
-lexer::Token::Token(Type         type,
-                    string       value,
-                    uint32       line,
-                    uint32       column,
-                    sptr<string> filename,
-                    sptr<string> line_contents,
-                    sptr<Token>  expanded,
-                    sptr<lexer::TokenStream> include) {
-    this->line          = line;
-    this->column        = column;
-    this->type          = type;
-    this->value         = value;
-    this->line_contents = line_contents;
-    this->filename      = filename;
-    this->include       = include;
-    this->expanded      = expanded;
+/// \brief get the position of this token in its line (starting at 1)
+uint32 lexer::Token::column() const {
+    if (source == nullptr) { return 0; }
+    return offset - source->lineStart(line()) + 1;
+}
+
+/// \brief get the contents of this tokens (first) line. Only meant for error messages
+string_view lexer::Token::lineContents() const {
+    if (source == nullptr) { return ""; }
+    return source->lineContents(line());
+}
+
+/// \brief get the name of the file this token comes from
+const string& lexer::Token::filename() const {
+    static const string unknown = "";
+    return source == nullptr ? unknown : source->name;
+}
+
+/// \brief get the value of an INT, HEX or BINARY token, as decoded by the lexer
+lexer::NumericLiteral lexer::Token::number() const {
+    if (literal == 0) { return decodeNumber(value(), type); }
+    return source->literals[literal - 1];
 }
 
 bool lexer::Token::operator==(Token other) {
-    return other.type == type and other.line == line and other.column == column;
+    return other.type == type and other.source == source and other.offset == offset;
 }
 
 bool lexer::Token::operator!=(Token other) {
     return !(other == *this);
 }
 
-/// \brief create a string representation
-string lexer::Token::_str() const {
-    return value;
+TEST_CASE ("Testing lexer::Token positions", "[tokens]") {
+    lexer::Source source(0, "test.cst", "a\n  bc\n\nd");
+    lexer::Token  a(lexer::Token::SYMBOL, &source, 0, 1);
+    lexer::Token  bc(lexer::Token::SYMBOL, &source, 4, 2);
+    lexer::Token  d(lexer::Token::SYMBOL, &source, 8, 1);
+
+    REQUIRE(a.value() == "a");
+    REQUIRE(a.column() == 1);
+    REQUIRE(a.lineContents() == "a");
+    REQUIRE(bc.value() == "bc");
+    REQUIRE(bc.line() == 2);
+    REQUIRE(bc.column() == 3);
+    REQUIRE(bc.lineContents() == "  bc");
+    REQUIRE(d.line() == 4);
+    REQUIRE(d.column() == 1);
+    REQUIRE(d.lineContents() == "d");
+    REQUIRE(d.filename() == "test.cst");
+    REQUIRE(lexer::Token().value() == "");
 }
 
 /// \brief create a string representation
-string lexer::TokenStream::_str() const {
+string lexer::TokenStream::toString() const {
     string s;
-    for (uint64 t = start; t < stop; t++) { s += tokens->at(t).value + " "; }
+    for (uint64 t = start; t < stop; t++) { s += string(tokens->at(t).value()) + " "; }
     return s;
 }
 
 /// \brief construct a new Match
 ///
-lexer::TokenStream::Match::Match(uint64 at, const TokenStream* on) {
-    this->at        = at;
-    this->was_found = true;
-    this->on        = make_shared<TokenStream>(*on);
-}
+lexer::TokenStream::Match::Match(uint64 at, const TokenStream* on)
+    : tokens(on->tokens), start(on->start), stop(on->stop), at(at), was_found(true) {}
 
 /// \brief construct a new Match
 ///
-lexer::TokenStream::Match::Match(bool) {
-    this->was_found = false;
-    this->at        = 0;
+lexer::TokenStream::Match::Match(bool) {}
+
+/// \brief get the stream this was found on
+lexer::TokenStream lexer::TokenStream::Match::on() const {
+    TokenStream stream = TokenStream::none();
+    stream.tokens      = tokens;
+    stream.start       = start;
+    stream.stop        = stop;
+    return stream;
 }
 
 /// \brief construct a new TokenStream
 ///
-/// \param tokens actual token data. Is shared between many TokenStreams to save space
+/// \param tokens actual token data. Kept alive by the SourceManager of the current session
 /// \param start virtual start index on vactor
 /// \param stop if stop is 0xFFFF'FFFF'FFFF'FFFF (uint64 max value), stop will be chosen as the last element of tokens
 lexer::TokenStream::TokenStream(sptr<vector<Token>> tokens, uint64 start, uint64 stop) {
-    this->tokens = tokens;
+    if (tokens != nullptr) { this->tokens = SourceManager::current().keep(tokens); }
     if (stop == 0xFFFF'FFFF'FFFF'FFFF && tokens != nullptr) { stop = tokens->size(); }
     this->stop  = stop;
     this->start = start;
 }
 
+/// \brief construct a TokenStream viewing tokens owned by the caller, which has to keep them alive
+///
+lexer::TokenStream::TokenStream(vector<Token>& tokens, uint64 start, uint64 stop) {
+    this->tokens = &tokens;
+    if (stop == 0xFFFF'FFFF'FFFF'FFFF) { stop = tokens.size(); }
+    this->stop  = stop;
+    this->start = start;
+}
+
 TEST_CASE ("Testing lexer::TokenStream::TokenStream", "[tokens]") {
     // create TokenStream
     vector<lexer::Token> tokens = {lexer::Token(), lexer::Token()};
@@ -102,7 +138,10 @@ REQUIRE(t.size() == 2);
 lexer::TokenStream lexer::TokenStream::slice(int64 start, int64 stop) const {
     if (start < 0) start = size()+start;
     if (stop < 0) stop = size()+stop;
-    return lexer::TokenStream(tokens, this->start+start, this->start+stop);
+    lexer::TokenStream out = *this;
+    out.start              = this->start + start;
+    out.stop               = this->start + stop;
+    return out;
 }
 
 TEST_CASE ("Testing lexer::TokenStream::slice", "[tokens]") {
@@ -126,62 +165,34 @@ lexer::Token lexer::TokenStream::get(int64 idx) const {
     return tokens->at(start + idx);
 }
 
-/// \brief flip values of a pair
-template<typename A, typename B>
-pair<B,A> flip(const pair<A,B>& p)
-{
-    return pair<B,A>(p.second, p.first);
-}
-
-/// \brief flip values of a std::map
-template<typename A, typename B>
-map<B,A> invert(const map<A,B>& src)
-{
-    map<B,A> dst;
-    transform(src.begin(), src.end(), inserter(dst, dst.begin()), 
-                   flip<A,B>);
-    return dst;
-}
-
-
-lexer::TokenStream::Match lexer::TokenStream::splitStack(
-    initializer_list<lexer::Token::Type> sep,
-    uint64                               start_idx,
-    map<lexer::Token::Type, lexer::Token::Type> mapping) const {
-
-        map<lexer::Token::Type, lexer::Token::Type> mapping_rev = invert(mapping);
-        stack<lexer::Token> typestack = {};
-
-        uint32 idx = start_idx;
-        for(;idx < size(); idx++){
-            Token& t = tokens->at(this->start+idx);
-            if (typestack.size() == 0 and find(sep.begin(), sep.end(), t.type) != sep.end()) {
-                return Match(idx, this);
-            }
-
-            if (mapping.count(t.type)){
-                typestack.push(t);
-            }
-            else if (mapping_rev.count(t.type)){
-                if (typestack.top().type != mapping_rev[t.type]){
-                    parser::error({0, "Expected '"_s + to_string(mapping_rev[typestack.top().type]) + "'"},{t},
-                        "Expected '"_s + to_string(mapping_rev[typestack.top().type]) + "', found " + t.value);
-                    parser::note({typestack.top()}, "to match this '"_s + to_string(typestack.top().type));
-                }
-                typestack.pop();
-            }
-
-            if (typestack.size() == 0 and find(sep.begin(), sep.end(), t.type) != sep.end()) {
-                return Match(idx, this);
+lexer::TokenStream::Match lexer::TokenStream::splitStack(initializer_list<lexer::Token::Type> sep,
+                                                        uint64                               start_idx) const {
+    uint64 depth = 0; ///< nesting of brackets without partner
+    for (uint64 idx = start_idx; idx < size(); idx++) {
+        const Token& t = (*tokens)[this->start + idx];
+        if (depth == 0 and find(sep.begin(), sep.end(), t.type) != sep.end()) { return Match(idx, this); }
+
+        if (opensGroup(t.type)) {
+            if (t.partner == 0) {
+                depth++;
+                continue;
             }
-        }
-        while (not typestack.empty()){
-            parser::error({0, "Unclosed '"_s + to_string(typestack.top().type) + "'"}, {typestack.top()},"");
-            typestack.pop();
+            idx += t.partner; // skip the whole group
+            if (idx >= size()) { break; }
+        } else if (closesGroup(t.type)) {
+            if (depth == 0) { continue; }
+            depth--;
+        } else {
+            continue;
         }
 
-        return false;
+        // the closing bracket might be a seperator itself
+        if (depth == 0 and find(sep.begin(), sep.end(), (*tokens)[this->start + idx].type) != sep.end()) {
+            return Match(idx, this);
+        }
     }
+    return false;
+}
 
 TEST_CASE ("Testing lexer::TokenStream::splitStack", "[tokens]") {
     SECTION("checking positive example"){
@@ -212,44 +223,47 @@ TEST_CASE ("Testing lexer::TokenStream::splitStack", "[tokens]") {
     }
 }
 
-lexer::TokenStream::Match lexer::TokenStream::rsplitStack(
-    initializer_list<lexer::Token::Type> sep,
-    uint64                               start_idx,
-    map<lexer::Token::Type, lexer::Token::Type> mapping_rev) const {
-
-        map<lexer::Token::Type, lexer::Token::Type> mapping = invert(mapping_rev);
-        stack<lexer::Token> typestack = {};
-
-        int32 idx = size()-1-start_idx;
-        for(;idx >= 0; idx--){
-            Token& t = tokens->at(this->start+idx);
-            if (typestack.size() == 0 and find(sep.begin(), sep.end(), t.type) != sep.end()) {
-                return Match(idx, this);
-            }
-
-            if (mapping.count(t.type)){
-                typestack.push(t);
-            }
-            else if (mapping_rev.count(t.type)){
-                if (typestack.top().type != mapping_rev[t.type]){
-                    parser::error({0, "Expected '"_s + to_string(mapping_rev[typestack.top().type]) + "'"},{t},
-                        "Expected '"_s + to_string(mapping_rev[typestack.top().type]) + "', found " + t.value);
-                    parser::note({typestack.top()}, "to match this '"_s + to_string(typestack.top().type));
-                }
-                typestack.pop();
-            }
+TEST_CASE ("Testing lexer::TokenStream::splitStack with matched brackets", "[tokens]") {
+    lexer::TokenStream t = lexer::tokenize("a, (b, [c, d]), {e, f}; g");
+
+    REQUIRE((int64) t.splitStack({lexer::Token::COMMA}) == 1);
+    REQUIRE((int64) t.splitStack({lexer::Token::COMMA}, 2) == 11);
+    REQUIRE((int64) t.splitStack({lexer::Token::END_CMD}) == 17);
+    REQUIRE((int64) t.splitStack({lexer::Token::CLOSE}, 2) == 10);
+    REQUIRE((int64) t.rsplitStack({lexer::Token::COMMA}) == 11);
+    REQUIRE((int64) t.rsplitStack({lexer::Token::OPEN}, 8) == 2);
+    REQUIRE(not t.slice(0, 5).splitStack({lexer::Token::END_CMD}).found()); // group reaches out of the window
+    REQUIRE((int64) t.slice(4, 17).splitStack({lexer::Token::CLOSE}) == 6);   // window starts inside a group
+}
 
-            if (typestack.size() == 0 and find(sep.begin(), sep.end(), t.type) != sep.end()) {
-                return Match(idx, this);
+lexer::TokenStream::Match lexer::TokenStream::rsplitStack(initializer_list<lexer::Token::Type> sep,
+                                                         uint64                               start_idx) const {
+    uint64 depth = 0; ///< nesting of brackets without partner
+    for (int64 idx = size() - 1 - start_idx; idx >= 0; idx--) {
+        const Token& t = (*tokens)[this->start + idx];
+        if (depth == 0 and find(sep.begin(), sep.end(), t.type) != sep.end()) { return Match(idx, this); }
+
+        if (closesGroup(t.type)) {
+            if (t.partner == 0) {
+                depth++;
+                continue;
             }
-        }
-        while (not typestack.empty()){
-            parser::error({0, "Unopened '"_s + to_string(typestack.top().type) + "'"}, {typestack.top()}, "");
-            typestack.pop();
+            idx -= t.partner; // skip the whole group
+            if (idx < 0) { break; }
+        } else if (opensGroup(t.type)) {
+            if (depth == 0) { continue; }
+            depth--;
+        } else {
+            continue;
         }
 
-        return false;
+        // the opening bracket might be a seperator itself
+        if (depth == 0 and find(sep.begin(), sep.end(), (*tokens)[this->start + idx].type) != sep.end()) {
+            return Match(idx, this);
+        }
     }
+    return false;
+}
 
 TEST_CASE ("Testing lexer::TokenStream::rsplitStack", "[tokens]") {
     SECTION("checking positive example"){
@@ -273,6 +287,117 @@ TEST_CASE ("Testing lexer::TokenStream::rsplitStack", "[tokens]") {
 }
 
 
+#ifdef CATCH2
+namespace {
+
+    thread_local usize* counted_allocations = nullptr; ///< counter of the innermost AllocationCounter of a thread
+
+    ///
+    /// \brief counts the heap allocations of the calling thread while it exists
+    ///
+    /// Allocations of other threads and allocations outside of its lifetime are not counted.
+    ///
+    class AllocationCounter final {
+            usize* previous;
+
+        public:
+            usize count = 0; ///< allocations so far
+
+            AllocationCounter() : previous(counted_allocations) { counted_allocations = &count; }
+            AllocationCounter(const AllocationCounter&)            = delete;
+            AllocationCounter& operator=(const AllocationCounter&) = delete;
+            ~AllocationCounter() { counted_allocations = previous; }
+    };
+
+    /// \brief split a statement the way the expression parsers do, without building AST nodes
+    ///
+    /// \return number of operands found
+    usize splitStatement(lexer::TokenStream statement) {
+        lexer::TokenStream::Match set      = statement.splitStack({lexer::Token::SET});
+        lexer::TokenStream        value    = set.found() ? set.after() : statement;
+        usize                     operands = 0;
+        while (true) {
+            lexer::TokenStream::Match m       = value.rsplitStack({lexer::Token::ADD, lexer::Token::SUB});
+            lexer::TokenStream        operand = m.found() ? m.after() : value;
+            operands++;
+            if (operand.size() > 2 and operand[1].type == lexer::Token::OPEN) { // call, split its arguments
+                lexer::TokenStream args = operand.slice(2, -1);
+                for (lexer::TokenStream::Match a = args.splitStack({lexer::Token::COMMA}); a.found();
+                     a                           = args.splitStack({lexer::Token::COMMA})) {
+                    operands += splitStatement(a.before());
+                    args      = a.after();
+                }
+                operands += splitStatement(args);
+            }
+            if (not m.found()) { return operands; }
+            value = m.before();
+        }
+    }
+
+    /// \brief split all statements of some tokens
+    ///
+    /// \return number of statements
+    usize splitStatements(lexer::TokenStream tokens, usize& operands) {
+        usize statements = 0;
+        for (lexer::TokenStream::Match m = tokens.splitStack({lexer::Token::END_CMD}); m.found();
+             m                           = tokens.splitStack({lexer::Token::END_CMD})) {
+            operands += splitStatement(m.before());
+            tokens    = m.after();
+            statements++;
+        }
+        return statements;
+    }
+
+} // namespace
+
+// behaves like the default, but lets an AllocationCounter see the allocations of its thread
+void* operator new(usize size) {
+    if (counted_allocations != nullptr) { (*counted_allocations)++; }
+    while (true) {
+        if (void* p = malloc(size == 0 ? 1 : size)) { return p; }
+        new_handler handler = get_new_handler();
+        if (handler == nullptr) { throw bad_alloc(); }
+        handler();
+    }
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, usize) noexcept {
+    free(p);
+}
+
+TEST_CASE ("Testing lexer::TokenStream searches do not allocate", "[tokens]") {
+    string text = "";
+    for (usize i = 0; i < 100; i++) { text += "a = f(b + 1, c[2] - g(d, e)) + h(i) - 3;\n"; }
+    lexer::TokenStream tokens   = lexer::tokenize(text);
+    usize              operands = 0;
+
+    AllocationCounter allocations;
+    usize             statements = splitStatements(tokens, operands);
+
+    REQUIRE(statements == 100);
+    REQUIRE(operands == 100 * 10);
+    REQUIRE(allocations.count == 0);
+}
+
+TEST_CASE ("Benchmarking lexer::TokenStream searches", "[.benchmark][tokens]") {
+    string text = "";
+    for (usize i = 0; i < 100'000; i++) { text += "a = f(b + 1, c[2] - g(d, e)) + h(i) - 3;\n"; }
+    lexer::TokenStream tokens   = lexer::tokenize(text);
+    usize              operands = 0;
+
+    AllocationCounter allocations;
+    auto              start      = chrono::steady_clock::now();
+    usize             statements = splitStatements(tokens, operands);
+    float64           seconds    = chrono::duration<float64>(chrono::steady_clock::now() - start).count();
+    WARN ("lexer::TokenStream: " << float64(statements) / seconds / 1e6 << " M statements/s, "
+                                 << float64(allocations.count) / float64(statements) << " allocations per statement");
+}
+#endif
+
 /// \brief split this Tokenstream on every occurance of a specific type
 ///
 /// \param sep list of tokens to be seperated at
@@ -285,7 +410,7 @@ vector<lexer::TokenStream> lexer::TokenStream::list(initializer_list<lexer::Toke
     while (m.found()){
         lexer::TokenStream tokens = slice(start_idx, m);
         if (not allow_empty and tokens.empty()){
-            parser::error({0, "Expected "_s + what}, slice(max<int32>(0,start_idx-1), min<int32>(m+1, size())), "Expected "_s + what + " after '" + get(max<int32>(0,start_idx-1)).value + "', but found nothing");
+            parser::error({0, "Expected "_s + what}, slice(max<int32>(0,start_idx-1), min<int32>(m+1, size())), "Expected "_s + what + " after '" + string(get(max<int32>(0,start_idx-1)).value()) + "', but found nothing");
         } else if (not tokens.empty()) {
             streams.push_back(tokens);
         }
@@ -319,8 +444,19 @@ TEST_CASE ("Testing lexer::TokenStream::list", "[tokens]") {
 }
 
 void lexer::TokenStream::cut(usize from, usize to){
-    tokens->erase(tokens->begin()+start+from, tokens->begin()+start+to);
-    stop -= to-from;
+    from += start;
+    to   += start;
+    // shrink the groups around the removed tokens
+    for (usize j = 0; j < from; j++) {
+        Token& t = (*tokens)[j];
+        if (opensGroup(t.type) and t.partner != 0 and j + t.partner >= to) { t.partner -= to - from; }
+    }
+    for (usize k = to; k < tokens->size(); k++) {
+        Token& t = (*tokens)[k];
+        if (closesGroup(t.type) and t.partner != 0 and k - t.partner < from) { t.partner -= to - from; }
+    }
+    tokens->erase(tokens->begin() + from, tokens->begin() + to);
+    stop -= to - from;
 }
 
 TEST_CASE("Testing lexer::TokenStream::cut", "[tokens]"){
@@ -336,12 +472,34 @@ TEST_CASE("Testing lexer::TokenStream::cut", "[tokens]"){
 }
 
 void lexer::TokenStream::paste(lexer::TokenStream t, usize idx){
-    for (lexer::Token tok : *(t.tokens)){
-        tokens->insert(tokens->begin() + (idx++), tok);
+    usize count = t.tokens->size();
+    // grow the groups around the insertion point
+    for (usize j = 0; j < idx; j++) {
+        Token& tok = (*tokens)[j];
+        if (opensGroup(tok.type) and tok.partner != 0 and j + tok.partner >= idx) { tok.partner += count; }
     }
+    for (usize k = idx; k < tokens->size(); k++) {
+        Token& tok = (*tokens)[k];
+        if (closesGroup(tok.type) and tok.partner != 0 and k - tok.partner < idx) { tok.partner += count; }
+    }
+    tokens->insert(tokens->begin() + idx, t.tokens->begin(), t.tokens->end());
     stop += t.size();
 }
 
+TEST_CASE("Testing lexer::TokenStream::cut and paste keep partners", "[tokens]"){
+    lexer::TokenStream t = lexer::tokenize("{ a ( b ) c }");
+
+    t.cut(1, 2);
+    REQUIRE(t[0].partner == 5);
+    REQUIRE(t[5].partner == 5);
+    REQUIRE(t[1].partner == 2);
+    t.paste(lexer::tokenize("x y"), 4);
+    REQUIRE(t[0].partner == 7);
+    REQUIRE(t[7].partner == 7);
+    REQUIRE(t[1].partner == 2);
+    REQUIRE((int64) t.splitStack({lexer::Token::BLOCK_CLOSE}, 1) == 7);
+}
+
 TEST_CASE("Testing lexer::TokenStream::include", "[tokens]"){
     vector<lexer::Token> tokens = {lexer::Token::COMMA,lexer::Token::INT,
                                     lexer::Token::COMMA,lexer::Token::INT};
@@ -356,124 +514,39 @@ TEST_CASE("Testing lexer::TokenStream::include", "[tokens]"){
 }
 
 lexer::TokenStream lexer::TokenStream::copy(){
-    vector<lexer::Token> toks = *tokens;
+    vector<lexer::Token> toks(tokens->begin() + start, tokens->begin() + stop);
     return lexer::TokenStream(make_shared<vector<lexer::Token>>(toks));
 }
 
 void lexer::TokenStream::include(int64 start, int64 stop, lexer::TokenStream tokens){
-    sptr<lexer::TokenStream> t = make_shared<lexer::TokenStream>(slice(start, stop).copy());
     cut(start, stop);
-    for (Token ts : *tokens.tokens){
-        ts.include = t;
-    }
     paste(tokens, start);
 }
 
 lexer::TokenStream lexer::TokenStream::none() {return {nullptr};}
 
 string to_string(lexer::Token::Type t){
-    switch (t) {
-        default: return "symbol/none";        ///< undefined token
-        case lexer::Token::END_CMD: return ";";
-
-                    //  LITERALS  //
-        case lexer::Token::NULV: return "null";
-
-                    //    MATH    //
-        case lexer::Token::SET: return "=";
-        case lexer::Token::ADD: return "+";
-        case lexer::Token::SUB: return "-";
-        case lexer::Token::MUL: return "*";
-        case lexer::Token::DIV: return "/";
-        case lexer::Token::MOD: return "%";
-        case lexer::Token::POW: return "**";
-        case lexer::Token::INC: return "++";
-        case lexer::Token::DEC: return "--";
-        //NEC      ,        ///< `- <int>`
-
-        case lexer::Token::NEG: return "~";
-        case lexer::Token::AND: return "&";
-        case lexer::Token::OR: return "|";
-        case lexer::Token::XOR: return "^";
-        case lexer::Token::SHL: return "<<";
-        case lexer::Token::SHR: return ">>";
-        case lexer::Token::LSHR: return ">>>";
-
-                    //  LOGICAL   //
-        case lexer::Token::LAND: return "and";
-        case lexer::Token::LOR: return "or";
-        case lexer::Token::NOT: return "not";
-
-                    // COMPARISON //
-        case lexer::Token::EQ: return "==";
-        case lexer::Token::NEQ: return "!=";
-        case lexer::Token::LT: return "<";
-        case lexer::Token::GT: return ">";
-        case lexer::Token::GEQ: return ">=";
-        case lexer::Token::LEQ: return "<=";
-
-                    //    FLOW    //
-        case lexer::Token::QM: return "?";
-        case lexer::Token::IN: return ":";
-        case lexer::Token::UNPACK: return "<-";
-        case lexer::Token::REF: return "#";
-        case lexer::Token::RMREF: return "#!";
-        case lexer::Token::RMREFT: return "&!";
-                
-        case lexer::Token::SUBNS: return "::";
-        case lexer::Token::ACCESS: return ".";
-        case lexer::Token::COMMA: return ",";
-        case lexer::Token::DOTDOT: return "..";
-        case lexer::Token::DOTDOTDOT: return "...";
-
-                    // PARANTHESIS //
-        case lexer::Token::OPEN: return "(";
-        case lexer::Token::CLOSE: return ")";
-        case lexer::Token::BLOCK_OPEN: return "{";
-        case lexer::Token::BLOCK_CLOSE: return "}";
-        case lexer::Token::INDEX_OPEN: return "[";
-        case lexer::Token::INDEX_CLOSE: return "]";
-
-                    //  KEYWORDS  //
-        case lexer::Token::IF: return "if";
-        case lexer::Token::ELSE: return "else";
-        case lexer::Token::FOR: return "for";
-        case lexer::Token::WHILE: return "while";
-        case lexer::Token::LOOP: return "loop";
-        case lexer::Token::THROW: return "throw";
-        case lexer::Token::BREAK: return "break";
-        case lexer::Token::CONTINUE: return "continue";
-        case lexer::Token::NOIMPL: return "noimpl";
-        case lexer::Token::RETURN: return "return";
-        case lexer::Token::AS: return "as";
-        case lexer::Token::OPERATOR: return "operator";
-        case lexer::Token::SWITCH: return "switch";
-        case lexer::Token::CASE: return "case";
-        case lexer::Token::FINALLY: return "finally";
-        case lexer::Token::NEW: return "new";
-        case lexer::Token::DELETE: return "delete";
-
-        case lexer::Token::IMPORT: return "import";
-        case lexer::Token::REQ: return "req";
-        case lexer::Token::QER: return "qer";
-        case lexer::Token::MACRO: return "macro";
-        case lexer::Token::INCLUDE: return "include";
-
-        case lexer::Token::CLASS: return "class";
-        case lexer::Token::ENUM: return "enum";
-        case lexer::Token::STRUCT: return "struct";
-        case lexer::Token::VIRTUAL: return "virtual";
-        case lexer::Token::ABSTRACT: return "abstract";
-        case lexer::Token::FINAL: return "final";
-        case lexer::Token::NAMESPACE: return "namespace";
-        case lexer::Token::FRIEND: return "friend";
-        case lexer::Token::PROTECTED: return "protected";
-        case lexer::Token::PRIVATE: return "private";
-        case lexer::Token::STATIC: return "static";
-        case lexer::Token::PUBLIC: return "public";
-        case lexer::Token::MUT: return "mut";
-        case lexer::Token::CONST: return "const";
-        case lexer::Token::NOWRAP: return "nowrap";
-        case lexer::Token::X: return "x";
+    string_view name = lexer::typeName(t);
+    if (name.empty()) { return "symbol/none"; } ///< undefined token
+    return string(name);
+}
+
+TEST_CASE("Testing lexer::spellings", "[tokens]"){
+    SECTION("spelling -> type"){
+        for (const lexer::Spelling& s : lexer::spellings){
+            REQUIRE(lexer::lookupSpelling(s.text, s.kind) == s.type);
+        }
+        REQUIRE(lexer::lookupSpelling("include", lexer::Spelling::OPERATOR) == lexer::Token::NONE);
+        REQUIRE(lexer::lookupSpelling("(", lexer::Spelling::KEYWORD) == lexer::Token::NONE);
+        REQUIRE(lexer::lookupSpelling("foo", lexer::Spelling::KEYWORD) == lexer::Token::NONE);
+        REQUIRE(lexer::lookupSpelling("", lexer::Spelling::KEYWORD) == lexer::Token::NONE);
+    }
+    SECTION("type -> spelling"){
+        REQUIRE(to_string(lexer::Token::LSHR) == ">>>");
+        REQUIRE(to_string(lexer::Token::INCLUDE) == "include");
+        REQUIRE(to_string(lexer::Token::INT) == "symbol/none");
+        for (const lexer::Spelling& s : lexer::spellings){
+            if (s.kind & lexer::Spelling::NAME) { REQUIRE(to_string(s.type) == s.text); }
+        }
     }
 }
@@ -1,10 +1,12 @@
 #pragma once
 
 #include "../snippets.hpp"
+#include "source.hpp"
 
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <sys/types.h>
 #include <vector>
 
@@ -19,14 +21,13 @@ namespace lexer {
     ///
     /// \brief Represents a single Token.
     ///
-    class Token : public Repr {
-        protected:
-            /// \brief create a string representation
-            string _str() const;
-
+    /// A Token does not own its text. It references a range of the Source it was lexed from,
+    /// which keeps it small and cheap to copy.
+    ///
+    class Token final {
         public:
             /// \brief represents all different types a Token can be
-            enum Type {
+            enum Type : uint8 {
                 // clang-format off
             
                     //  SPECIAL   //
@@ -144,37 +145,45 @@ namespace lexer {
                 // clang-format on
             };
 
-            Type   type;  ///< this tokens type
-            string value; ///< this tokens contents
-
-            uint32 line   = 0; ///< the line of this token in its file
-            uint32 column = 0; ///< the position of this token in this line
-
-            sptr<Token> expanded = nullptr; ///< \brief macro expanded from.
-                                            ///<
-                                            ///< if this token was expanded from a macro,
-                                            ///< its token is referenced here for error detection
-
-            sptr<string> filename;          ///< filename this token comes from
-            sptr<string> line_contents;     ///< this tokens line's contents (for error messages)
-            sptr<lexer::TokenStream> include = nullptr; ///< included file this comes from
+            const Source* source  = nullptr; ///< source this token was lexed from
+            uint32        offset  = 0;       ///< position of this token in its source's text
+            uint32        length  = 0;       ///< length of this token in its source's text
+            union {
+                    uint32 literal = 0; ///< numbers: 1 + index of the decoded value in source->literals, 0 if none
+                    uint32 partner;     ///< brackets: distance to the matching bracket, 0 if it has none
+            };
+            Type          type    = NONE;    ///< this tokens type
 
             Token() = default;
 
             /// \brief construct a token
-            Token(Type         type,
-                  string       value,
-                  uint32       line,
-                  uint32       column,
-                  sptr<string> filename,
-                  sptr<string> line_contents,
-                  sptr<Token>  expanded = nullptr,
-                  sptr<lexer::TokenStream> include  = nullptr);
+            Token(Type type, const Source* source, uint32 offset, uint32 length)
+                : source(source), offset(offset), length(length), type(type) {}
 
             /// \brief construct a token from a type. ONLY FOR TEST CASES!
-            Token(Type type) { this->type = type; }
+            Token(Type type) : type(type) {}
 
-            virtual ~Token() = default;
+            /// \brief get this tokens contents
+            string_view value() const {
+                return source == nullptr ? string_view() : string_view(source->text).substr(offset, length);
+            }
+
+            /// \brief get the value of an INT, HEX or BINARY token, as decoded by the lexer
+            ///
+            /// Tokens without a decoded value (like the ones created in test cases) are decoded on the spot.
+            NumericLiteral number() const;
+
+            /// \brief get the line of this token in its file (starting at 1)
+            uint32 line() const { return source == nullptr ? 0 : source->lineOf(offset); }
+
+            /// \brief get the position of this token in its line (starting at 1)
+            uint32 column() const;
+
+            /// \brief get the contents of this tokens (first) line. Only meant for error messages
+            string_view lineContents() const;
+
+            /// \brief get the name of the file this token comes from
+            const string& filename() const;
 
             /// \brief compare two Tokens
             /// \return true if tokens type and position is the same
@@ -184,6 +193,23 @@ namespace lexer {
             /// \return false if tokens type and position is the same
             bool operator!=(Token other);
     };
+
+    static_assert(sizeof(Token) <= 24, "Tokens are copied a lot, keep them small");
+
+    /// \brief check if a token type opens a bracket group (`(`, `[` or `{`)
+    inline bool opensGroup(Token::Type t) {
+        return t == Token::OPEN or t == Token::INDEX_OPEN or t == Token::BLOCK_OPEN;
+    }
+
+    /// \brief check if a token type closes a bracket group (`)`, `]` or `}`)
+    inline bool closesGroup(Token::Type t) {
+        return t == Token::CLOSE or t == Token::INDEX_CLOSE or t == Token::BLOCK_CLOSE;
+    }
+
+    /// \brief get the closing bracket for an opening bracket type
+    inline Token::Type closingOf(Token::Type open) {
+        return open == Token::OPEN ? Token::CLOSE : open == Token::INDEX_OPEN ? Token::INDEX_CLOSE : Token::BLOCK_CLOSE;
+    }
 } // namespace lexer
 
 ///
@@ -191,12 +217,7 @@ namespace lexer {
 ///
 string to_string(lexer::Token::Type t);
 
-const lexer::Token nullToken = lexer::Token(lexer::Token::NONE,
-                                            "",
-                                            0,
-                                            0,
-                                            sptr<string>(new string),
-                                            nullptr); ///< Token constant representing an empty token
+const lexer::Token nullToken = lexer::Token(); ///< Token constant representing an empty token
 
 namespace lexer {
 
@@ -204,24 +225,31 @@ namespace lexer {
     ///
     /// Because vectors and arrays cannot be searched or sliced easyly (something the compiler needs),
     /// TokenStream does this by manipulating start and stop variables. a TokenStream window spans from start to stop.
-    class TokenStream final : public Repr {
+    ///
+    /// A TokenStream is a plain view, copying or slicing it never allocates or touches a reference count.
+    /// The token vectors themselves are kept alive by the SourceManager of a session, next to their sources.
+    class TokenStream final {
         public:
-            uint64              start = 0; ///< virtual start index
-            uint64              stop  = 0; ///< virtual stop index
-            sptr<vector<Token>> tokens;    ///< actual data
+            uint64         start  = 0;       ///< virtual start index
+            uint64         stop   = 0;       ///< virtual stop index
+            vector<Token>* tokens = nullptr; ///< actual data
 
-        protected:
             /// \brief create a string representation
-            string _str() const;
+            string toString() const;
 
-        public:
             /// \brief represents a TokenStream search result
             ///
             /// Since we often need to search a token and then slice at its position, this class handles this.
+            /// Like TokenStream it is a plain view.
             class Match final {
-                    uint64            at        = 0;       ///< where this result was found (relative index)
-                    bool              was_found = false;   ///< whether something was found
-                    sptr<TokenStream> on        = nullptr; ///< on what stream it was found
+                    vector<Token>* tokens    = nullptr; ///< data of the stream it was found on
+                    uint64         start     = 0;       ///< window of the stream it was found on
+                    uint64         stop      = 0;
+                    uint64         at        = 0;       ///< where this result was found (relative index)
+                    bool           was_found = false;   ///< whether something was found
+
+                    /// \brief get the stream this was found on
+                    TokenStream on() const;
 
                 public:
                     /// \brief construct a new Match
@@ -243,12 +271,12 @@ namespace lexer {
                     /// \brief get all tokens before this match
                     ///
                     /// \return TokenStream with all tokens before this match, or empty tokenstream if failed
-                    TokenStream before() const { return found() ? on->slice(0, at) : TokenStream({}); }
+                    TokenStream before() const { return found() ? on().slice(0, at) : TokenStream::none(); }
 
                     /// \brief get all tokens after this match
                     ///
                     /// \return TokenStream with all tokens after this match, or empty tokenstream if failed
-                    TokenStream after() const { return found() ? on->slice(at + 1, on->size()) : TokenStream({}); }
+                    TokenStream after() const { return found() ? on().slice(at + 1, stop - start) : TokenStream::none(); }
 
                     /// \return position of this match (0 if not succeded)
                     ///
@@ -257,12 +285,16 @@ namespace lexer {
 
             /// \brief construct a new TokenStream
             ///
-            /// \param tokens actual token data. Is shared between many TokenStreams to save space
+            /// \param tokens actual token data. Kept alive by the SourceManager of the current session
             /// \param start virtual start index on vactor
             /// \param stop if stop is 0xFFFF'FFFF'FFFF'FFFF (uint64 max value), stop will be chosen as the last element
             /// of tokens
             TokenStream(sptr<vector<Token>> tokens, uint64 start = 0, uint64 stop = 0xFFFF'FFFF'FFFF'FFFF);
 
+            /// \brief construct a TokenStream viewing tokens owned by the caller, which has to keep them alive
+            ///
+            TokenStream(vector<Token>& tokens, uint64 start = 0, uint64 stop = 0xFFFF'FFFF'FFFF'FFFF);
+
             /// \brief get a substream of this stream
             ///
             /// slicing (extracting a substream) is a core requirement of this compiler.
@@ -296,33 +328,22 @@ namespace lexer {
             ///
             bool empty() const noexcept { return size() == 0; }
 
-            /// \brief split this tokenstream at the first occur of a token.
-            /// uses a stack to make sure the context. Starts from the front
+            /// \brief split this tokenstream at the first occur of a token outside of brackets.
+            /// Starts from the front
+            ///
+            /// Bracket groups matched by the lexer are skipped at once (\see Token::partner),
+            /// others are tracked with a depth counter. Unbalanced brackets are reported by the lexer, not here.
             ///
             /// \param sep list of Token::Type that will split this tokenstream
             /// \param start_idx at which index to start
-            /// \param mapping map of paired Token::Type. first is open, second is close
-            Match splitStack(initializer_list<lexer::Token::Type>        sep,
-                             uint64                                      start_idx = 0,
-                             map<lexer::Token::Type, lexer::Token::Type> mapping   = {
-                                 {lexer::Token::OPEN,       lexer::Token::CLOSE      },
-                                 {lexer::Token::INDEX_OPEN, lexer::Token::INDEX_CLOSE},
-                                 {lexer::Token::BLOCK_OPEN, lexer::Token::BLOCK_CLOSE}
-            }) const;
-
-            /// \brief split this tokenstream at the first occur of a token.
-            /// uses a stack to make sure the context. Starts from the back
+            Match splitStack(initializer_list<lexer::Token::Type> sep, uint64 start_idx = 0) const;
+
+            /// \brief split this tokenstream at the first occur of a token outside of brackets.
+            /// Starts from the back
             ///
             /// \param sep list of Token::Type that will split this tokenstream
             /// \param start_idx at which index to start
-            /// \param mapping map of paired Token::Type. first is open, second is close
-            Match rsplitStack(initializer_list<lexer::Token::Type>        sep,
-                              uint64                                      start_idx = 0,
-                              map<lexer::Token::Type, lexer::Token::Type> mapping   = {
-                                  {lexer::Token::OPEN,       lexer::Token::CLOSE      },
-                                  {lexer::Token::INDEX_OPEN, lexer::Token::INDEX_CLOSE},
-                                  {lexer::Token::BLOCK_OPEN, lexer::Token::BLOCK_CLOSE}
-            }) const;
+            Match rsplitStack(initializer_list<lexer::Token::Type> sep, uint64 start_idx = 0) const;
 
             /*
             Match split(std::initializer_list<lexer::Token::Type>, uint64 start_idx = 0) const;
@@ -338,19 +359,22 @@ namespace lexer {
             ///
             /// \brief remove the tokens between these indices
             ///
-            /// Note that this modifies ALL tokenstreams on this vector and should not be done while subvectors exist
+            /// Note that this modifies ALL tokenstreams on this vector and should not be done while subvectors exist.
+            /// Brackets around the removed tokens keep their partners
             ///
             void cut(usize start, usize stop);
 
             ///
-            /// \brief add the tokens of this stream to this stream
+            /// \brief add the tokens of this stream to this stream.
+            /// Brackets around the insertion point keep their partners
             ///
             /// \param index where to put it after
             ///
             void paste(TokenStream t, usize idx);
 
             ///
-            /// \brief add the tokens replacing the old tokens using "include" fields
+            /// \brief add the tokens replacing the old tokens.
+            /// Where the tokens were included from is recorded in their Source (`included_from`)
             ///
             void include(int64 start, int64 stop, lexer::TokenStream tokens);
 
@@ -361,4 +385,17 @@ namespace lexer {
 
             // Match operator[](lexer::Token::Type type) { return split({type}); }
     };
+
+    static_assert(is_trivially_copyable_v<TokenStream>, "TokenStreams are views, copying them must stay cheap");
+    static_assert(is_trivially_copyable_v<TokenStream::Match>, "Matches are views, copying them must stay cheap");
 } // namespace lexer
+
+/// \brief create a string representation of a TokenStream
+inline string str(const lexer::TokenStream& tokens) {
+    return tokens.toString();
+}
+
+/// \brief create a string representation of a TokenStream
+inline string str(const lexer::TokenStream* tokens) {
+    return tokens->toString();
+}
@@ -0,0 +1,331 @@
+#include "token_cache.hpp"
+
+#include "../helpers/string_functions.hpp"
+#include "../session.hpp"
+#include "lexer.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+lexer::TokenCache lexer::token_cache;
+
+// layout: Header, SourceRecord[source_count], LiteralRecord[literal_count], MarkRecord[mark_count],
+// TokenRecord[token_count], names
+namespace {
+    struct Header {
+            char   magic[8];
+            uint32 version;
+            int32  pretty_size; ///< lexer setting the entry was lexed with, it changes the diagnostics
+            uint32 source_count;
+            uint32 literal_count;
+            uint32 mark_count;
+            uint32 token_count;
+            uint64 names_size;
+    };
+
+    struct TokenRecord {
+            uint32 source; ///< index in the sources of the entry
+            uint32 offset;
+            uint32 length;
+            uint32 literal; ///< or partner
+            uint32 type;
+    };
+
+    struct SourceRecord {
+            int64       mtime;
+            uint64      size;
+            uint32      name; ///< offset in names
+            uint32      name_length;
+            uint32      literal_begin; ///< this sources literals in the literal records
+            uint32      literal_count;
+            TokenRecord include[2]; ///< the include statement this source was included by
+    };
+
+    struct LiteralRecord {
+            uint64 low;
+            uint64 high;
+            uint64 overflow;
+    };
+
+    struct MarkRecord {
+            uint32 start;
+            uint32 stop;
+    };
+
+    constexpr char entry_magic[8] = {'C', 'S', 'T', 'T', 'O', 'K', '\0', '\0'};
+} // namespace
+
+void lexer::TokenCache::enable(string directory) {
+    error_code error;
+    filesystem::create_directories(directory, error);
+    if (filesystem::is_directory(directory, error)) { this->directory = std::move(directory); }
+}
+
+string lexer::TokenCache::entryPath(const string& file) const {
+    error_code error;
+    char       name[32];
+    uint64     key = fnv1a(filesystem::absolute(file, error).string());
+    snprintf(name, sizeof(name), "%016llx.tok", (unsigned long long) key);
+    return directory + "/" + name;
+}
+
+optional<lexer::TokenCache::Entry> lexer::TokenCache::load(const string& file) {
+    if (not enabled()) { return nullopt; }
+    int fd = open(entryPath(file).c_str(), O_RDONLY);
+    if (fd < 0) {
+        miss_count++;
+        return nullopt;
+    }
+    struct stat info;
+    void*       map  = MAP_FAILED;
+    usize       size = 0;
+    if (fstat(fd, &info) == 0 and (usize) info.st_size >= sizeof(Header)) {
+        size = info.st_size;
+        map  = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        miss_count++;
+        return nullopt;
+    }
+
+    auto entry = [&]() -> optional<Entry> {
+        const char*   data   = (const char*) map;
+        const Header* header = (const Header*) data;
+        if (memcmp(header->magic, entry_magic, sizeof(entry_magic)) != 0 or header->version != version or
+            header->pretty_size != CompilationSession::current().pretty_size or header->source_count == 0) {
+            return nullopt;
+        }
+        uint64 expected = sizeof(Header) + (uint64) header->source_count * sizeof(SourceRecord) +
+                          (uint64) header->literal_count * sizeof(LiteralRecord) +
+                          (uint64) header->mark_count * sizeof(MarkRecord) +
+                          (uint64) header->token_count * sizeof(TokenRecord) + header->names_size;
+        if (expected != size) { return nullopt; }
+        const SourceRecord*  sources  = (const SourceRecord*) (data + sizeof(Header));
+        const LiteralRecord* literals = (const LiteralRecord*) (sources + header->source_count);
+        const MarkRecord*    marks    = (const MarkRecord*) (literals + header->literal_count);
+        const TokenRecord*   tokens   = (const TokenRecord*) (marks + header->mark_count);
+        const char*          names    = (const char*) (tokens + header->token_count);
+
+        // check every source and record before loading any source
+        vector<string> files = {};
+        for (uint32 s = 0; s < header->source_count; s++) {
+            const SourceRecord& record = sources[s];
+            if ((uint64) record.name + record.name_length > header->names_size or
+                (uint64) record.literal_begin + record.literal_count > header->literal_count) {
+                return nullopt;
+            }
+            files.emplace_back(names + record.name, record.name_length);
+            struct stat current;
+            if (stat(files.back().c_str(), &current) != 0 or (uint64) current.st_size != record.size or
+                (int64) current.st_mtim.tv_sec * 1000000000 + current.st_mtim.tv_nsec != record.mtime) {
+                return nullopt;
+            }
+        }
+
+        auto valid = [&](const TokenRecord& record, uint32 source_count) { // a token of one of the first sources
+            return record.source < source_count and
+                   (uint64) record.offset + record.length <= sources[record.source].size;
+        };
+        for (uint32 s = 1; s < header->source_count; s++) {
+            if (not valid(sources[s].include[0], s) or not valid(sources[s].include[1], s)) { return nullopt; }
+        }
+        for (uint32 t = 0; t < header->token_count; t++) {
+            if (not valid(tokens[t], header->source_count)) { return nullopt; }
+        }
+        for (uint32 m = 0; m < header->mark_count; m++) {
+            if (marks[m].start > marks[m].stop or marks[m].stop > header->token_count) { return nullopt; }
+        }
+
+        SourceManager&  manager = SourceManager::current();
+        vector<Source*> loaded  = {};
+        for (uint32 s = 0; s < header->source_count; s++) {
+            loaded.push_back(&manager.load(files[s]));
+            if (loaded.back()->text.size() != sources[s].size or loaded.back()->mtime != sources[s].mtime) {
+                for (Source* source : loaded) { manager.release(*source); } // changed since it was checked
+                return nullopt;
+            }
+        }
+        auto token = [&](const TokenRecord& record) {
+            Token t(Token::Type(record.type), loaded[record.source], record.offset, record.length);
+            t.literal = record.literal;
+            return t;
+        };
+        for (uint32 s = 0; s < header->source_count; s++) {
+            Source& source = *loaded[s];
+            if (s > 0) {
+                vector<Token> include = {token(sources[s].include[0]), token(sources[s].include[1])};
+                source.included_from  = make_shared<TokenStream>(make_shared<vector<Token>>(std::move(include)));
+            }
+            for (uint32 l = sources[s].literal_begin; l < sources[s].literal_begin + sources[s].literal_count; l++) {
+                uint128 value = (uint128) literals[l].high << 64 | literals[l].low;
+                source.literals.push_back({value, literals[l].overflow != 0});
+            }
+        }
+
+        Entry out = {make_shared<vector<Token>>(), {}, loaded};
+        out.tokens->reserve(header->token_count);
+        for (uint32 t = 0; t < header->token_count; t++) { out.tokens->push_back(token(tokens[t])); }
+        for (uint32 m = 0; m < header->mark_count; m++) { out.marks.push_back({marks[m].start, marks[m].stop}); }
+        return out;
+    }();
+    munmap(map, size);
+    if (entry) {
+        hit_count++;
+    } else {
+        miss_count++;
+    }
+    return entry;
+}
+
+void lexer::TokenCache::store(const string&                       file,
+                              const vector<Source*>&              sources,
+                              const vector<Token>&                tokens,
+                              const vector<pair<uint32, uint32>>& marks) {
+    if (not enabled() or sources.empty()) { return; }
+    vector<SourceRecord>  source_records  = {};
+    vector<LiteralRecord> literal_records = {};
+    vector<MarkRecord>    mark_records    = {};
+    vector<TokenRecord>   token_records   = {};
+    string                names           = "";
+
+    map<const Source*, uint32> indices = {};
+    for (usize s = 0; s < sources.size(); s++) { indices[sources[s]] = s; }
+    auto record = [&](const Token& token, TokenRecord& out) {
+        auto source = indices.find(token.source);
+        if (source == indices.end()) { return false; }
+        out = {source->second, token.offset, token.length, token.literal, token.type};
+        return true;
+    };
+    for (usize s = 0; s < sources.size(); s++) {
+        const Source* source = sources[s];
+        if (source->mtime < 0) { return; } // not read from a file, nothing to check it against
+        SourceRecord out = {};
+        out.mtime        = source->mtime;
+        out.size         = source->text.size();
+        out.name         = names.size();
+        out.name_length  = source->name.size();
+        names           += source->name;
+        if (s > 0) {
+            if (source->included_from == nullptr or source->included_from->size() != 2 or
+                not record((*source->included_from)[0], out.include[0]) or
+                not record((*source->included_from)[1], out.include[1]) or out.include[0].source >= s) {
+                return;
+            }
+        }
+        out.literal_begin = literal_records.size();
+        out.literal_count = source->literals.size();
+        for (const NumericLiteral& literal : source->literals) {
+            literal_records.push_back({(uint64) literal.value, (uint64) (literal.value >> 64), literal.overflow});
+        }
+        source_records.push_back(out);
+    }
+    for (auto [start, stop] : marks) { mark_records.push_back({start, stop}); }
+    token_records.resize(tokens.size());
+    for (usize t = 0; t < tokens.size(); t++) {
+        if (not record(tokens[t], token_records[t])) { return; }
+    }
+
+    Header header;
+    memcpy(header.magic, entry_magic, sizeof(entry_magic));
+    header.version       = version;
+    header.pretty_size   = CompilationSession::current().pretty_size;
+    header.source_count  = source_records.size();
+    header.literal_count = literal_records.size();
+    header.mark_count    = mark_records.size();
+    header.token_count   = token_records.size();
+    header.names_size    = names.size();
+
+    // other compiler processes may read the entry at any time, so it is renamed into place once complete
+    string path      = entryPath(file);
+    string temporary = path + "." + to_string(getpid()) + "." + to_string(hash<thread::id>()(this_thread::get_id()));
+    FILE*  out       = fopen(temporary.c_str(), "wb");
+    if (out == nullptr) { return; }
+    bool written = fwrite(&header, sizeof(Header), 1, out) == 1;
+    auto write   = [&](auto& records) {
+        using Record = typename remove_reference_t<decltype(records)>::value_type;
+        if (records.empty()) { return; }
+        written = written and fwrite(records.data(), sizeof(Record), records.size(), out) == records.size();
+    };
+    write(source_records);
+    write(literal_records);
+    write(mark_records);
+    write(token_records);
+    written = written and fwrite(names.data(), 1, names.size(), out) == names.size();
+    written = fclose(out) == 0 and written;
+    if (not written or rename(temporary.c_str(), path.c_str()) != 0) { unlink(temporary.c_str()); }
+}
+
+TEST_CASE ("Testing lexer::TokenCache", "[tokens]") {
+    filesystem::path dir = filesystem::temp_directory_path() / "cstc_token_cache_test";
+    filesystem::remove_all(dir);
+    filesystem::create_directories(dir);
+    string main_file     = (dir / "main.cst").string();
+    string included_file = (dir / "included.txt").string();
+    ofstream(main_file) << "import a;\ninclude \"included.txt\"\nx = 0x10;";
+    ofstream(included_file) << "y = (2);";
+
+    lexer::TokenCache cache;
+    cache.enable((dir / "cache").string());
+    REQUIRE(not cache.load(main_file).has_value());
+
+    lexer::Source&     module   = lexer::SourceManager::current().load(main_file);
+    lexer::Source&     included = lexer::SourceManager::current().load(included_file);
+    lexer::TokenStream a        = lexer::tokenize(module);
+    lexer::TokenStream b        = lexer::tokenize(included);
+    included.included_from      = make_shared<lexer::TokenStream>(a.slice(3, 5).copy());
+    // splice like the preprocessor does
+    vector<lexer::Token> tokens(a.tokens->begin(), a.tokens->begin() + 3);
+    tokens.insert(tokens.end(), b.tokens->begin(), b.tokens->end());
+    tokens.insert(tokens.end(), a.tokens->begin() + 5, a.tokens->end());
+    cache.store(main_file, {&module, &included}, tokens, {{0, 3}});
+
+    optional<lexer::TokenCache::Entry> entry = cache.load(main_file);
+    REQUIRE(entry.has_value());
+    REQUIRE(cache.hits() == 1);
+    REQUIRE(entry->tokens->size() == tokens.size());
+    for (usize i = 0; i < tokens.size(); i++) {
+        REQUIRE((*entry->tokens)[i].type == tokens[i].type);
+        REQUIRE((*entry->tokens)[i].value() == tokens[i].value());
+        REQUIRE((*entry->tokens)[i].source->name == tokens[i].source->name);
+        REQUIRE((*entry->tokens)[i].literal == tokens[i].literal);
+    }
+    REQUIRE(entry->tokens->back().source != &module); // sources are loaded again
+    REQUIRE(entry->tokens->at(entry->tokens->size() - 2).number().value == 16);
+    REQUIRE(entry->tokens->at(4).source->included_from->toString() == a.slice(3, 5).toString());
+    REQUIRE((entry->marks == vector<pair<uint32, uint32>> {{0, 3}}));
+
+    // a broken entry is found out before any source is loaded
+    string       entry_file = filesystem::directory_iterator(dir / "cache")->path().string();
+    stringstream image;
+    image << ifstream(entry_file, ios::binary).rdbuf();
+    string      broken = image.str();
+    Header*     header = (Header*) broken.data();
+    MarkRecord* mark   = (MarkRecord*) (broken.data() + sizeof(Header) + header->source_count * sizeof(SourceRecord) +
+                                      header->literal_count * sizeof(LiteralRecord));
+    mark->stop         = header->token_count + 1;
+    ofstream(entry_file, ios::binary) << broken;
+    usize sources = lexer::SourceManager::current().size();
+    REQUIRE(not cache.load(main_file).has_value());
+    REQUIRE(lexer::SourceManager::current().size() == sources);
+    ofstream(entry_file, ios::binary) << image.str();
+
+    // another lexer setting or a changed include make the entry out of date
+    CompilationSession::current().pretty_size++;
+    REQUIRE(not cache.load(main_file).has_value());
+    CompilationSession::current().pretty_size--;
+    ofstream(included_file) << "y = (2, 3);";
+    REQUIRE(not cache.load(main_file).has_value());
+    REQUIRE(cache.misses() == 4);
+
+    filesystem::remove_all(dir);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+//
+// TOKEN_CACHE.hpp
+//
+// layouts the on-disk cache of preprocessed token arrays
+//
+
+#include "../snippets.hpp"
+#include "source.hpp"
+#include "token.hpp"
+
+#include <atomic>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace lexer {
+
+    ///
+    /// \brief stores the preprocessed tokens of a module on disk, so unchanged modules are not lexed again
+    ///
+    /// Every entry lists the sources its tokens come from (the module and its includes) with their
+    /// modification time and size. An entry is only used if none of them changed and it was written by the same
+    /// cache version with the same lexer settings. Entries are written to a temporary file and renamed,
+    /// so compiler processes sharing a cache directory never read a partial entry.
+    ///
+    class TokenCache final {
+            string directory = ""; ///< cache directory, empty if the cache is disabled
+
+            atomic<usize> hit_count  = 0;
+            atomic<usize> miss_count = 0;
+
+            /// \brief get the file an entry for a source file is stored in
+            string entryPath(const string& file) const;
+
+        public:
+            static constexpr uint32 version = 2; ///< increase whenever Token, the entry layout or import marks change
+
+            ///
+            /// \brief a cached token array
+            ///
+            struct Entry {
+                    sptr<vector<Token>>          tokens;  ///< tokens, pointing into the loaded sources
+                    vector<pair<uint32, uint32>> marks;   ///< token ranges stored along with the tokens
+                    vector<Source*>              sources; ///< the sources the tokens depend on, as stored
+            };
+
+            /// \brief use a directory (created if needed) for the cache
+            void enable(string directory);
+
+            /// \brief check if entries are loaded and stored
+            bool enabled() const { return not directory.empty(); }
+
+            /// \brief load the entry of a file, the sources it lists are loaded into the current SourceManager
+            ///
+            /// \return the entry, nullopt if there is none or it is out of date
+            optional<Entry> load(const string& file);
+
+            /// \brief store the preprocessed tokens of a file
+            ///
+            /// \param sources every source the tokens depend on, starting with the file itself.
+            ///                Sources other than the first need their included_from set.
+            /// \param tokens  the tokens, they may only point into sources
+            /// \param marks   token ranges to get back with the tokens
+            void store(const string&                       file,
+                       const vector<Source*>&              sources,
+                       const vector<Token>&                tokens,
+                       const vector<pair<uint32, uint32>>& marks);
+
+            /// \brief get the number of entries loaded
+            usize hits() const { return hit_count; }
+
+            /// \brief get the number of entries that were missing or out of date
+            usize misses() const { return miss_count; }
+    };
+
+    extern TokenCache token_cache; ///< token cache of all sessions, disabled by default
+
+} // namespace lexer
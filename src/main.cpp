@@ -5,34 +5,51 @@
 //
 
 // #include "build/optimizer_flags.hpp"
+#include "batch.hpp"
 #include "errors/errors.hpp"
+#include "graph.hpp"
+#include "helpers/build_db.hpp"
+#include "helpers/stat_cache.hpp"
 #include "helpers/string_functions.hpp"
 #include "lexer/lexer.hpp"
 #include "lexer/token.hpp"
+#include "lexer/token_cache.hpp"
 #include "module.hpp"
+#include "parser/interface.hpp"
+#include "server.hpp"
+#include "session.hpp"
 #include "snippets.hpp"
 // #include "build/targets.hpp"
 #include "../lib/argparse/include/argparse/argparse.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
 #include <ostream>
+#include <set>
+#include <vector>
 
 // EXIT CODE NAMES
 #define PROGRAM_EXIT      0
 #define EXIT_ARG_FAILURE  1
 #define EXIT_NO_MAIN_FILE 3
+#define EXIT_ONE_ERROR    3
 
-int32 main(int32 argc, const char** argv) {
-    /**
-     * @brief main function
-     */
-
-    // setup argument parsing
-    argparse::ArgumentParser argparser("cstc"s, "c0.01"s, argparse::default_arguments::help);
-    argparser.add_argument("file").help("main file of your program");
+/**
+ * @brief add the command-line arguments of cstc to a parser
+ */
+static void addArguments(argparse::ArgumentParser& argparser) {
+    argparser.add_argument("file")
+        .help("main file of your program, several main files are compiled as a batch")
+        .nargs(argparse::nargs_pattern::any)
+        .default_value(vector<string> {});
     argparser.add_argument("-l", "--list-modules").help("list all loaded modules").flag();
-    argparser.add_argument("-1", "--one-error").help("exit at first error").flag();
+    argparser.add_argument("-1", "--one-error").help("stop at first error").flag();
     argparser.add_argument("-p", "--punish").help("treat warnings as errors").flag();
     argparser.add_argument("--version").help("display version info and exit").flag();
     argparser.add_argument("--max-line-len")
@@ -42,6 +59,25 @@ int32 main(int32 argc, const char** argv) {
     argparser.add_argument("--target").help("target for cross-compiler").default_value<string>("linux:x86:64:llvm");
     argparser.add_argument("--entrypoint").help("entrypoint function").default_value<string>("main");
     argparser.add_argument("--no-std-lang").help("disable autoloading lang module").flag();
+    argparser.add_argument("--no-cache").help("do not load or store preprocessed tokens and module interfaces").flag();
+    argparser.add_argument("--cache-dir")
+        .help("directory of the token and interface cache")
+        .default_value<string>(".cstc-cache");
+    argparser.add_argument("--incremental")
+        .help("only rebuild modules that changed or whose imported interfaces changed since the last build")
+        .flag();
+    argparser.add_argument("--serve")
+        .help("stay resident: keep modules loaded, watch their files and answer compile requests on --socket")
+        .flag();
+    argparser.add_argument("--connect")
+        .help("send this compilation to the daemon on --socket, compile here if there is none")
+        .flag();
+    argparser.add_argument("--socket").help("socket of the compiler daemon").default_value<string>(".cstc.sock");
+    argparser.add_argument("--batch")
+        .help("compile the programs whose main files are listed in a file (one per line) in one process, sharing lang");
+    argparser.add_argument("--graph")
+        .help("write the module graph with the time each module took and the critical path to <main>.modules.<format> "
+              "[json|dot]");
     argparser.add_argument("--list-targets").help("list all available targets and exit").flag();
     argparser.add_argument("--opt").help("choose optimizer preset [none|disable|all]").default_value<string>("all");
     argparser.add_argument("--opt:constant-folding")
@@ -50,16 +86,81 @@ int32 main(int32 argc, const char** argv) {
     argparser.add_argument("--opt:chaos")
         .help("enable or disable register chaos optimizer (good for pipelining) [W.I.P.]")
         .default_value<string>("true");
+}
 
-    // try to parse arguments
-    try {
-        argparser.parse_args(argc, argv);
-    } catch (const exception& err) {
-        cerr << err.what() << endl;
-        cerr << argparser;
-        return EXIT_ARG_FAILURE;
+/**
+ * @brief get the directory of a project, the directory its main file is in
+ */
+static string projectDirectory(const string& main_file) {
+    fs::path project = fs::path(main_file).parent_path();
+    return project.empty() ? "." : project.string();
+}
+
+/**
+ * @brief set up what the compilations of this process share
+ */
+static void setUp(argparse::ArgumentParser& argparser) {
+    // check for std environment variable
+    if (Module::stdLibLocation() == "") {
+        cerr << "\e[1;33mWARNING: \e[0m\e[1mCSTC_STD\e[0m environment variable could not be found.\n"
+                "This may cause problems with std::* modules.\n"
+             << endl;
+    }
+
+    if (argparser["--no-cache"] == false) {
+        lexer::token_cache.enable(argparser.get("--cache-dir"));
+        symbol::interface_cache.enable(argparser.get("--cache-dir"));
+    }
+}
+
+/**
+ * @brief write a build database, a database that can not be written only costs the next build time
+ */
+static void save(const BuildDatabase& database) {
+    if (not database.save()) {
+        cerr << "\e[1;33mWARNING: \e[0mthe build database could not be written, the next build is a full one" << endl;
+    }
+}
+
+/**
+ * @brief check the format of --graph
+ *
+ * @return false if it is not a known format, this was reported then
+ */
+static bool checkGraph(argparse::ArgumentParser& argparser) {
+    optional<string> format = argparser.present("--graph");
+    if (format and not graph::parseFormat(*format)) {
+        cerr << "\e[1;31mERROR:\e[0m --graph only allows the formats 'json' and 'dot'" << endl;
+        return false;
     }
+    return true;
+}
+
+/**
+ * @brief write the module graph of the current session next to the main file
+ */
+static void writeGraph(const string& main_file, graph::Format format) {
+    fs::path file = fs::path(main_file).replace_extension("modules."s + graph::extension(format));
+    ofstream out(file);
+    graph::write(out, CompilationSession::current().modules, format);
+    if (out) {
+        cout << "\e[36;1mINFO: module graph written to " << file.string() << "\e[0m" << endl;
+    } else {
+        cerr << "\e[1;33mWARNING: \e[0mthe module graph could not be written to " << file.string() << endl;
+    }
+}
 
+/**
+ * @brief compile a program in the current session
+ *
+ * @param argparser the parsed command-line arguments
+ * @param main_file main file of the program
+ * @param database build database to skip up-to-date modules with and to record the modules in. nullptr for a full
+ * build, the caller saves it
+ *
+ * @return exit code
+ */
+static int32 compile(argparse::ArgumentParser& argparser, const string& main_file, BuildDatabase* database) {
     /*if (target::isValid(argparser.get("--target"))) {
         target::set(argparser.get("--target"));
     } else {
@@ -110,25 +211,13 @@ int32 main(int32 argc, const char** argv) {
         exit(0);
     }*/
 
-    // check for std environment variable
-    if (Module::stdLibLocation() == "") {
-        cerr << "\e[1;33mWARNING: \e[0m\e[1mCSTC_STD\e[0m environment variable could not be found.\n"
-                "This may cause problems with std::* modules.\n"
-             << endl;
-    }
-
-    if (argparser["--version"] == true) {
-        cout << "CSTC v0.01 - cst25" << endl;
-
-        exit(0);
-    }
-
-    parser::one_error  = argparser["-1"] == true;
-    lexer::pretty_size = argparser.get<int32>("--max-line-len");
-    if (lexer::pretty_size < -1) { lexer::pretty_size = -1; }
+    CompilationSession& session = CompilationSession::current();
+    session.one_error   = argparser["-1"] == true; // in a batch only the program with the error stops
+    session.pretty_size = argparser.get<int32>("--max-line-len");
+    if (session.pretty_size < -1) { session.pretty_size = -1; }
+    session.directory = fs::current_path(); // the main file is looked up in it, set before any module reads it
 
     // try to load the main file
-    string main_file = argparser.get("file");
     if (!filesystem::exists(filesystem::u8path(main_file))) {
         cout << "\e[1;31mERROR:\e[0m main file at \e[1m"s + main_file + "\e[0m not found!" << endl;
         return EXIT_NO_MAIN_FILE;
@@ -143,43 +232,67 @@ int32 main(int32 argc, const char** argv) {
         }
     }
     Module::create(main_file, fs::current_path().string(), "", false, lexer::TokenStream::none(), true, true);
+    Module::awaitFetched();
+    // errors are raised on any thread, -1 stops here once the jobs are done
+    if (session.stopped) { return EXIT_ONE_ERROR; }
 
     // sort modules for parsing
-    Module::modules.sort(Module::loadOrder);
-    cout << "\r\e[32mFetching modules: (" << Module::known_modules.size() << "/"
-         << Module::known_modules.size() + Module::unknown_modules.size() << ")\e[0m" << endl;
+    vector<vector<Module*>> levels = Module::buildLevels();
+    // modules only imported through import lists are not loaded
+    cout << "\r\e[32mFetching modules: (" << session.modules.size() << "/"
+         << session.modules.size() + session.unknown_modules.size() << ")\e[0m" << endl;
 
     if (argparser["-l"] == true) {
         // display a list of Modules loaded
-        cout << "\e[36;1mINFO: " << Module::known_modules.size() << " Module"
-             << (Module::known_modules.size() == 1 ? ""s : "s"s) << " loaded\e[0m" << endl;
+        cout << "\e[36;1mINFO: " << session.modules.size() << " Module" << (session.modules.size() == 1 ? ""s : "s"s)
+             << " loaded\e[0m" << endl;
         cout << "\t\e[36;1m[h]\e[0m - Header        \e[32;1m[m]\e[0m - Main file        \e[33;1m[s]\e[0m - STDlib      "
                 "  \e[31;1m[t]\e[0m - target depending        \e[1m[l]\e[0m - autoload"
              << endl
              << endl;
-        for (Module* m : Module::modules) { cout << "\t" << str(m) << endl; }
-        for (string m : Module::unknown_modules) {
+        for (Module* m : session.modules) { cout << "\t" << str(m) << endl; }
+        for (string m : session.unknown_modules) {
             cout << "\t\e[31m" << fillup(m, 60) << "missing" << "\e[0m" << endl;
         }
     }
     cout << endl;
 
-    cout << "Parsing modules (0/" << Module::modules.size() << ")";
+    cout << "Parsing modules (0/" << session.modules.size() << ")";
+
+    atomic<usize> up_to_date = 0;
 
-    for (Module* m : Module::modules) { m->parse(); }
+    // modules of a level only depend on earlier levels
+    for (vector<Module*>& level : levels) {
+        session.parallelFor(level.size(), [&](usize i) {
+            if (session.stopped) { return; }
+            if (database != nullptr and level[i]->upToDate(*database)) {
+                up_to_date++;
+            } else {
+                level[i]->parse();
+                level[i]->storeInterface();
+            }
+            if (database != nullptr) { level[i]->record(*database); }
+        });
+        if (session.stopped) { return EXIT_ONE_ERROR; }
+    }
 
-    cout << "\r\e[32mParsing modules (" << Module::modules.size() << "/" << Module::modules.size() << ")\e[0m" << endl;
+    cout << "\r\e[32mParsing modules (" << session.modules.size() << "/" << session.modules.size() << ")\e[0m" << endl;
+    if (database != nullptr) {
+        cout << "\e[36;1mINFO: " << up_to_date << " of " << session.modules.size() << " Modules up to date\e[0m"
+             << endl;
+    }
+    if (optional<string> format = argparser.present("--graph")) { writeGraph(main_file, *graph::parseFormat(*format)); }
 
-    if (parser::errc > 0 || parser::warnc > 0) {
+    if (session.errc > 0 || session.warnc > 0) {
         cout << "\n";
-        cout << parser::errc << " error" << (parser::errc == 1 ? ", " : "s, ") << parser::warnc << " warning"
-             << (parser::warnc == 1 ? "" : "s") << " generated\n";
-        if (parser::warnc > 0 && argparser["-p"] == true) {
+        cout << session.errc << " error" << (session.errc == 1 ? ", " : "s, ") << session.warnc << " warning"
+             << (session.warnc == 1 ? "" : "s") << " generated\n";
+        if (session.warnc > 0 && argparser["-p"] == true) {
             cout << "Treating warnings as errors (--punish)\n\e[1;31mCompilation aborted\e[0m\n";
-            exit(2);
-        } else if (parser::errc > 0) {
+            return 2;
+        } else if (session.errc > 0) {
             cout << "\e[1;31mCompilation aborted\e[0m\n";
-            exit(2);
+            return 2;
         }
     }
     
@@ -188,3 +301,191 @@ int32 main(int32 argc, const char** argv) {
     return PROGRAM_EXIT;
 }
 
+/**
+ * @brief stay resident and answer compile requests. The modules of the last compilation are kept, only the ones
+ * whose files changed are read again
+ *
+ * @return exit code
+ */
+static int32 serve(argparse::ArgumentParser& argparser, const vector<string>& args, const string& main_file) {
+    CompilationSession        session; // kept between requests
+    CompilationSession::Scope scope(session);
+    BuildDatabase             database(projectDirectory(main_file));
+    server::Watcher           watcher;
+    vector<string>            last_args = {};
+
+    auto handle = [&](const vector<string>& request_args) -> int32 {
+        argparse::ArgumentParser request("cstc"s, "c0.01"s, argparse::default_arguments::help);
+        addArguments(request);
+        try {
+            request.parse_args(request_args);
+        } catch (const exception& err) {
+            cerr << err.what() << endl;
+            cerr << request;
+            return EXIT_ARG_FAILURE;
+        }
+        if (request["--serve"] == true) {
+            cerr << "\e[1;31mERROR:\e[0m this is the daemon already" << endl;
+            return EXIT_ARG_FAILURE;
+        }
+        if (not checkGraph(request)) { return EXIT_ARG_FAILURE; }
+        vector<string> main_files = request.get<vector<string>>("file");
+        if (main_files.size() != 1 or request.present("--batch")) {
+            cerr << "\e[1;31mERROR:\e[0m the daemon compiles one main file per request" << endl;
+            return EXIT_ARG_FAILURE;
+        }
+        if (request["-1"] == true) { // stopping would leave the kept modules half done
+            cerr << "\e[1;31mERROR:\e[0m -1 is not supported by the daemon" << endl;
+            return EXIT_ARG_FAILURE;
+        }
+
+        // the modules only fit compilations with the same arguments
+        vector<string>        options = request_args;
+        optional<set<string>> changed = watcher.changes();
+        erase(options, "--connect"s);
+        // refresh() reads changed modules in jobs, which may already report errors
+        session.errc  = 0;
+        session.warnc = 0;
+        if (not changed or options != last_args) {
+            Module::clear();
+            stat_cache.clear(); // any file may have been created or removed
+        } else {
+            Module::refresh(*changed);
+        }
+        last_args = options;
+
+        int32 code;
+        try {
+            code = compile(request, main_files.front(), &database);
+        } catch (...) { // the modules may be half done
+            Module::clear();
+            last_args = {};
+            throw;
+        }
+        if (code != EXIT_NO_MAIN_FILE) {
+            if (request["--incremental"] == true) { save(database); }
+            database.commit();
+        }
+        for (auto& [name, m] : session.known_modules) {
+            for (string& file : m->files()) { watcher.watch(fs::path(file).parent_path().string()); }
+        }
+        return code;
+    };
+
+    vector<string> warm_up = args;
+    erase(warm_up, "--serve"s);
+    handle(warm_up); // load the modules before the first request
+    cout << "\e[36;1mINFO: serving on " << argparser.get("--socket") << "\e[0m" << endl;
+    return server::serve(argparser.get("--socket"), handle);
+}
+
+/**
+ * @brief compile many programs in this process, each in its own session. lang is loaded once and shared by all of
+ * them, programs of the same project share its build database
+ *
+ * @return the highest exit code of the programs
+ */
+static int32 compileBatch(argparse::ArgumentParser& argparser, const vector<string>& main_files) {
+    CompilationSession shared;
+    if (argparser["--no-std-lang"] == false) {
+        CompilationSession::Scope scope(shared);
+        shared.pretty_size = max(argparser.get<int32>("--max-line-len"), -1);
+        Module::create("lang", "", "", true); // a missing lang is reported by every program
+        Module::awaitFetched();
+        for (vector<Module*>& level : Module::buildLevels()) {
+            shared.parallelFor(level.size(), [&](usize i) {
+                level[i]->parse();
+                level[i]->storeInterface();
+            });
+        }
+        cout << "\r\e[36;1mINFO: " << shared.known_modules.size() << " shared Module"
+             << (shared.known_modules.size() == 1 ? ""s : "s"s) << " loaded\e[0m" << endl;
+        if (shared.errc > 0 or (shared.warnc > 0 and argparser["-p"] == true)) { // every program would fail
+            cout << "\e[1;31mCompilation aborted\e[0m\n";
+            return 2;
+        }
+    }
+
+    map<string, uptr<BuildDatabase>> databases = {}; ///< project directory -> its database
+    if (argparser["--incremental"] == true) {
+        for (const string& main_file : main_files) {
+            uptr<BuildDatabase>& database = databases[projectDirectory(main_file)];
+            if (database == nullptr) { database = make_unique<BuildDatabase>(projectDirectory(main_file)); }
+        }
+    }
+
+    int32 code = batch::run(main_files, shared, [&](const string& main_file) {
+        auto database = databases.find(projectDirectory(main_file));
+        return compile(argparser, main_file, database == databases.end() ? nullptr : database->second.get());
+    });
+    for (auto& [directory, database] : databases) { save(*database); }
+    return code;
+}
+
+int32 main(int32 argc, const char** argv) {
+    /**
+     * @brief main function
+     */
+
+    // setup argument parsing
+    argparse::ArgumentParser argparser("cstc"s, "c0.01"s, argparse::default_arguments::help);
+    addArguments(argparser);
+
+    // try to parse arguments
+    try {
+        argparser.parse_args(argc, argv);
+    } catch (const exception& err) {
+        cerr << err.what() << endl;
+        cerr << argparser;
+        return EXIT_ARG_FAILURE;
+    }
+
+    vector<string> args(argv, argv + argc);
+    vector<string> main_files = argparser.get<vector<string>>("file");
+    if (argparser["--connect"] == true) {
+        if (optional<int32> code = server::forward(argparser.get("--socket"), args)) { return *code; }
+        cerr << "\e[1;33mWARNING: \e[0mno daemon on \e[1m" << argparser.get("--socket")
+             << "\e[0m, compiling here" << endl;
+    }
+    setUp(argparser);
+
+    if (argparser["--version"] == true) {
+        cout << "CSTC v0.01 - cst25" << endl;
+
+        return PROGRAM_EXIT;
+    }
+    if (not checkGraph(argparser)) { return EXIT_ARG_FAILURE; }
+
+    if (optional<string> list = argparser.present("--batch")) {
+        optional<vector<string>> listed = batch::readList(*list);
+        if (not listed) {
+            cerr << "\e[1;31mERROR:\e[0m batch list at \e[1m" << *list << "\e[0m could not be read" << endl;
+            return EXIT_ARG_FAILURE;
+        }
+        main_files.insert(main_files.end(), listed->begin(), listed->end());
+    } else if (main_files.empty()) {
+        cerr << "file: required." << endl;
+        cerr << argparser;
+        return EXIT_ARG_FAILURE;
+    }
+    if (argparser.present("--batch") or main_files.size() > 1) {
+        if (argparser["--serve"] == true) {
+            cerr << "\e[1;31mERROR:\e[0m the daemon compiles a single main file" << endl;
+            return EXIT_ARG_FAILURE;
+        }
+        return compileBatch(argparser, main_files);
+    }
+    if (argparser["--serve"] == true) {
+        if (argparser["-1"] == true) {
+            cerr << "\e[1;31mERROR:\e[0m -1 is not supported by the daemon" << endl;
+            return EXIT_ARG_FAILURE;
+        }
+        return serve(argparser, args, main_files.front());
+    }
+
+    optional<BuildDatabase> project; // the last build of the project, kept next to the main file
+    if (argparser["--incremental"] == true) { project.emplace(projectDirectory(main_files.front())); }
+    int32 code = compile(argparser, main_files.front(), project ? &*project : nullptr);
+    if (project and code != EXIT_NO_MAIN_FILE and code != EXIT_ONE_ERROR) { save(*project); }
+    return code;
+}
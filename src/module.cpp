@@ -11,14 +11,20 @@
 #include "errors/errors.hpp"
 #include "lexer/lexer.hpp"
 #include "lexer/token.hpp"
+#include "lexer/token_cache.hpp"
+#include "parser/interface.hpp"
 // #include "parser/ast/ast.hpp"
 #include "helpers/string_functions.hpp"
+#include "helpers/stat_cache.hpp"
+#include "helpers/std_index.hpp"
 // #include "parser/ast/flow.hpp"
 #include "parser/symboltable.hpp"
 #include "snippets.hpp"
 
 #include <algorithm>
 #include <asm-generic/errno.h>
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
@@ -28,19 +34,12 @@
 // #include <memory>
 #include <optional>
 #include <ostream>
+#include <set>
 #include <string>
 #include <sys/types.h>
 #include <utility>
 #include <vector>
 
-map<string, Module*> Module::known_modules =
-    {}; ///< A map of all compile-time known modules to allow faster acces when importing
-list<string> Module::unknown_modules = {}; ///< A map of all compile-time unknown modules to allow better error messages
-list<Module*> Module::modules = {}; ///< A list of all modules loaded. This is used to determine the compile order
-fs::path      Module::directory;    ///< Project directory
-
-uint64 parsed_modules = 0; ///< amount of parsed modules
-
 /**
  * @brief get the default stdlib location using the CSTC_STD environment variable
  */
@@ -57,12 +56,40 @@ inline string h(string s) {
     return s;
 }
 
+/**
+ * @brief get the stdlib directory, looked up once
+ */
+const string& stdLibRoot() {
+    static const string root = h(Module::stdLibLocation());
+    return root;
+}
+
+/**
+ * @brief get the index of the stdlib, loaded (or built) once per compilation. Forgotten by clear() and refresh(), so
+ * a resident compiler sees added stdlib modules
+ */
+const StdIndex& stdIndex(CompilationSession& session) {
+    lock_guard<mutex> guard(session.std_index_lock);
+    if (session.std_index == nullptr) { session.std_index = make_shared<const StdIndex>(stdLibRoot()); }
+    return *session.std_index;
+}
+
+/**
+ * @brief hash the contents of a file without keeping them. They are read into a Source of no SourceManager
+ */
+static uint64 hashFile(const string& path, uint64 hash) {
+    lexer::Source source(0, path);
+    return fnv1a(source.text, hash);
+}
+
 bool Module::isHeader() const {
-    return fs::exists(hst_file);
+    if (is_stdlib) { return stdIndex(session).find(module_name).value_or(StdIndex::Entry {}).has_header; }
+    return stat_cache.exists(hst_file);
 }
 
 bool Module::isKnown() const {
-    return fs::exists(cst_file);
+    if (is_stdlib) { return stdIndex(session).find(module_name).value_or(StdIndex::Entry {}).has_source; }
+    return stat_cache.exists(cst_file);
 }
 
 /**
@@ -76,6 +103,7 @@ bool Module::isKnown() const {
  * @param tokens tokens of the preprocessor-parser, used for error messages
  * @param is_main_file whether this is the main file. should not be set outside the main function.
  * @param from_path create this from a "real path" instead of a module
+ * @param lazy only register the module, it is preprocessed once a symbol is resolved (import lists)
  *
  * @return Newly created Module (Pointer) if succesful or nullptr
  */
@@ -85,7 +113,8 @@ Module* Module::create(string path,
                        bool               is_stdlib,
                        lexer::TokenStream tokens,
                        bool               is_main_file,
-                       bool               from_path) {
+                       bool               from_path,
+                       bool               lazy) {
     string module_name = "<unknown>";
     if (!from_path) { path = mod2Path(path); }
     usize pos = path.rfind(".");
@@ -95,7 +124,7 @@ Module* Module::create(string path,
 
     fs::path directory = fs::current_path();
     if (is_stdlib) {
-        directory   = fs::path(h(stdLibLocation()));
+        directory   = fs::path(stdLibRoot());
         module_name = path2Mod(path);
     } else {
         if (!from_path) {
@@ -111,34 +140,208 @@ Module* Module::create(string path,
     ////cout << path << endl;
     ////cout << module_name << endl;
 
-    if (known_modules.count(module_name) > 0) { return known_modules[module_name]; }
-    if (fs::exists(directory.string() + "/" + path + ".hst")) {
-        if (!fs::exists(directory.string() + "/" + path + ".cst")) {
-            parser::warn(parser::warnings["No implementation file found"],
-                         tokens,
-                         "Missing an implementation file (\".cst\") @ "_s + directory.string() + "/" + path);
-        }
-        known_modules[module_name] = new Module(path, directory.string(), module_name, is_stdlib, is_main_file);
-        modules.push_back(known_modules[module_name]);
-        return known_modules[module_name];
+    CompilationSession& session = CompilationSession::current();
+    if (Module* shared = session.sharedModule(module_name)) { return shared; }
+    auto known = [&]() { // with modules_lock held
+        auto m = session.known_modules.find(module_name);
+        return m == session.known_modules.end() ? nullptr : m->second;
+    };
+    auto reuse = [&](Module* m) { // without modules_lock held
+        if (not lazy) { m->require(); }
+        return m;
+    };
+    Module* existing = nullptr;
+    {
+        lock_guard<mutex> guard(session.modules_lock);
+        existing = known();
+    }
+    if (existing != nullptr) { return reuse(existing); }
+    // look for the files without holding the lock, another task may create the module meanwhile
+    bool has_header = false;
+    bool has_source = false;
+    if (is_stdlib) {
+        StdIndex::Entry entry = stdIndex(session).find(module_name).value_or(StdIndex::Entry {});
+        has_header            = entry.has_header;
+        has_source            = entry.has_source;
+    } else {
+        string base = directory.string() + "/" + path;
+        has_header  = stat_cache.exists(base + ".hst");
+        has_source  = stat_cache.exists(base + ".cst");
     }
-    if (fs::exists(directory.string() + "/" + path + ".cst")) {
-        known_modules[module_name] = new Module(path, directory.string(), module_name, is_stdlib, is_main_file);
-        modules.push_back(known_modules[module_name]);
-        return known_modules[module_name];
+
+    Module* created = nullptr;
+    {
+        lock_guard<mutex> guard(session.modules_lock);
+        existing = known();
+        if (existing == nullptr and (has_header or has_source)) {
+            created = session.known_modules[module_name] =
+                new Module(path, directory.string(), module_name, is_stdlib, is_main_file);
+            created->lazy = lazy;
+            if (not lazy) { cout << "\rFetching modules: (" << session.known_modules.size() << "/?)" << flush; }
+        } else if (existing == nullptr and
+                   find(session.unknown_modules.begin(), session.unknown_modules.end(), module_name) ==
+                       session.unknown_modules.end() and
+                   not tokens.empty()) {
+            session.unknown_modules.push_back(module_name);
+        } else if (existing == nullptr) {
+            return nullptr;
+        }
     }
-    if (find(unknown_modules.begin(), unknown_modules.end(), module_name) == unknown_modules.end() and
-        not tokens.empty()) {
+    if (existing != nullptr) { return reuse(existing); }
+    if (created == nullptr) {
         parser::error(parser::errors["Module not found"],
                       tokens,
                       "A module at "_s + directory.string() + "/" + path + " was not found");
-        unknown_modules.push_back(module_name);
+        return nullptr;
+    }
+    if (has_header and not has_source) {
+        parser::warn(parser::warnings["No implementation file found"],
+                     tokens,
+                     "Missing an implementation file (\".cst\") @ "_s + directory.string() + "/" + path);
+    }
+    if (not lazy) { session.submit([created]() { created->preprocess(); }); }
+    return created;
+}
+
+void Module::awaitFetched() {
+    CompilationSession& session = CompilationSession::current();
+    session.wait();
+
+    // walk the imports like the former recursive fetch did, so the order does not depend on the scheduling.
+    // The walk keeps its own stack, import chains can be longer than the call stack allows
+    struct Visit {
+            Module* module;
+            usize   next_import;
+    };
+    set<Module*>    visited = {};
+    vector<Module*> roots   = {};
+    if (session.known_modules.count("lang") > 0) { roots.push_back(session.known_modules["lang"]); }
+    for (auto& [name, m] : session.known_modules) {
+        if (m->is_main_file) { roots.push_back(m); }
+    }
+    list<Module*>& modules = session.modules;
+    modules.clear();
+    for (Module* root : roots) {
+        if (not visited.insert(root).second) { continue; }
+        vector<Visit> stack = {{root, 0}};
+        while (not stack.empty()) {
+            Visit& top = stack.back();
+            if (top.next_import == top.module->imports.size()) {
+                modules.push_back(top.module);
+                stack.pop_back();
+                continue;
+            }
+            Import& import = top.module->imports[top.next_import];
+            // add once the import is done, as the recursive fetch did. Shared modules are done already
+            if (&import.module->session == &session and visited.insert(import.module).second) {
+                stack.push_back({import.module, 0});
+                continue;
+            }
+            if (not top.module->linked) { top.module->add(import.alias, import.module); }
+            top.next_import++;
+            if (top.next_import == top.module->imports.size()) { top.module->linked = true; }
+        }
+    }
+}
+
+void Module::refresh(const set<string>& changed) {
+    CompilationSession&   session       = CompilationSession::current();
+    map<string, Module*>& known_modules = session.known_modules;
+    stat_cache.clear(); // files may have been created or removed
+    session.std_index = nullptr;
+    session.unknown_modules.clear();
+    session.parsed_modules = 0;
+
+    set<Module*> stale = {};
+    for (auto& [name, m] : known_modules) {
+        if (not m->clean) { stale.insert(m); } // its diagnostics are issued again
+        for (string& file : m->files()) {
+            if (changed.count(file) > 0) { stale.insert(m); }
+        }
+    }
+    set<Module*> gone = {};
+    for (auto it = known_modules.begin(); it != known_modules.end();) {
+        Module* m = it->second;
+        if (stale.count(m) > 0 and not m->isHeader() and not m->isKnown()) {
+            gone.insert(m);
+            it = known_modules.erase(it);
+        } else {
+            it++;
+        }
+    }
+    for (auto& [name, m] : known_modules) { // importers of a removed module report it
+        for (Import& import : m->imports) {
+            if (gone.count(import.module) > 0) { stale.insert(m); }
+        }
+        for (Import& import : m->lazy_imports) {
+            if (gone.count(import.module) > 0) { stale.insert(m); }
+        }
+    }
+    for (Module* m : gone) { // not deleted, it may still be included by other modules
+        m->reset();
+        stale.erase(m);
+    }
+    for (Module* m : stale) { m->reset(); }
+    for (Module* m : stale) {
+        if (not m->lazy) { session.submit([m]() { m->preprocess(); }); } // lazy ones once they are used again
+    }
+}
+
+void Module::clear() {
+    CompilationSession& session = CompilationSession::current();
+    session.wait();
+    for (auto& [name, m] : session.known_modules) { m->unlink(); }
+    for (auto& [name, m] : session.known_modules) { delete m; }
+    session.known_modules.clear();
+    session.unknown_modules.clear();
+    session.modules.clear();
+    session.parsed_modules = 0;
+    session.source_manager.clear();
+    session.std_index = nullptr;
+}
+
+void Module::unlink() {
+    for (auto entry = contents.begin(); entry != contents.end();) {
+        erase_if(entry->second, [](symbol::Reference* r) { return dynamic_cast<Module*>(r) != nullptr; });
+        entry = entry->second.empty() ? contents.erase(entry) : next(entry);
+    }
+    linked = false;
+}
+
+void Module::reset() {
+    unlink();
+    for (auto& [key, symbols] : contents) {
+        for (symbol::Reference* symbol : symbols) { delete symbol; }
     }
+    contents.clear();
+    imports.clear();
+    lazy_imports.clear();
+    for (lexer::Source* source : sources) { session.source_manager.release(*source); }
+    session.source_manager.release(tokens.tokens);
+    sources.clear();
+    interface_sources.clear();
+    tokens         = lexer::TokenStream({});
+    clean          = false;
+    from_interface = false;
+    declared       = false;
+    stats          = {};
+}
 
-    return nullptr;
+vector<string> Module::files() const {
+    vector<string> out = {};
+    auto           add = [&](const fs::path& file) {
+        error_code error;
+        out.push_back(fs::absolute(file, error).lexically_normal().string());
+    };
+    add(hst_file);
+    add(cst_file);
+    for (lexer::Source* source : sources) { add(source->name); }
+    for (const string& source : interface_sources) { add(source); }
+    return out;
 }
 
-Module::Module(string path, string dir, string module_name, bool is_stdlib, bool is_main_file) {
+Module::Module(string path, string dir, string module_name, bool is_stdlib, bool is_main_file)
+    : session(CompilationSession::current()) {
     loc = "";
     for (uint64 i = 0; i < module_name.size(); i++) {
         if (i < module_name.size() - 2 && module_name[i] == ':' && module_name[i + 1] == ':') {
@@ -154,14 +357,13 @@ Module::Module(string path, string dir, string module_name, bool is_stdlib, bool
     this->module_name  = module_name;
     ////cout << "name: " <<  this->module_name << endl;
 
-    directory = fs::path(dir);
-    cst_file  = fs::path(dir + "/" + path + ".cst");
-    hst_file  = fs::path(dir + "/" + path + ".hst");
-
-    cout << "\rFetching modules: (" << known_modules.size() + 1 << "/?)";
-    if (module_name != "lang" && known_modules.count("lang") > 0) { include.push_back(known_modules["lang"]); }
+    cst_file = fs::path(dir + "/" + path + ".cst");
+    hst_file = fs::path(dir + "/" + path + ".hst");
 
-    preprocess();
+    // constructed by create() while holding modules_lock
+    Module* lang = session.sharedModule("lang");
+    if (lang == nullptr and session.known_modules.count("lang") > 0) { lang = session.known_modules["lang"]; }
+    if (module_name != "lang" && lang != nullptr) { include.push_back(lang); }
 }
 
 /**
@@ -206,23 +408,98 @@ string Module::_str() const {
            (cst_file.string()) + "\e]8;;\e\\";
 }
 
-/**
- * @brief compare two modules about their load order
- *
- * @return true, if a should be loaded before b
- */
-bool Module::loadOrder(Module* a, Module* b) {
-    for (pair<string, Module*> p : a->deps) {
-        if (p.second == b) { return false; }
+vector<vector<Module*>> Module::buildLevels() {
+    CompilationSession& session = CompilationSession::current();
+    list<Module*>&      modules = session.modules;
+    Module*             lang    = session.known_modules.count("lang") > 0 ? session.known_modules["lang"] : nullptr;
+
+    // lang is included by every module, except the ones lang itself depends on
+    set<Module*> lang_deps = {};
+    if (lang != nullptr) {
+        vector<Module*> todo = {lang};
+        while (not todo.empty()) {
+            Module* m = todo.back();
+            todo.pop_back();
+            if (not lang_deps.insert(m).second) { continue; }
+            for (Import& import : m->imports) { todo.push_back(import.module); }
+        }
     }
-    for (symbol::Namespace* m : a->include) {
-        if (m == b) { return false; }
+
+    map<Module*, usize>           order      = {}; ///< position in modules, keeps the levels deterministic
+    map<Module*, set<Module*>>    pending    = {}; ///< dependencies that are not in a level yet
+    map<Module*, vector<Module*>> dependents = {};
+    for (Module* m : modules) {
+        usize position = order.size();
+        order[m]       = position;
     }
-    return true;
+    // modules of a shared session are built already
+    auto depend = [&](Module* m, Module* dep) {
+        if (dep != nullptr and order.count(dep) > 0 and pending[m].insert(dep).second) { dependents[dep].push_back(m); }
+    };
+    for (Module* m : modules) {
+        pending[m] = {};
+        for (Import& import : m->imports) { depend(m, import.module); }
+        if (lang_deps.count(m) > 0) { continue; }
+        for (symbol::Namespace* ns : m->include) { depend(m, dynamic_cast<Module*>(ns)); }
+    }
+
+    vector<vector<Module*>> levels = {};
+    vector<Module*>         ready  = {};
+    usize                   placed = 0;
+    for (Module* m : modules) {
+        if (pending[m].empty()) { ready.push_back(m); }
+    }
+    while (placed < modules.size()) {
+        if (ready.empty()) { // every module left is in or behind a cycle, follow the imports until one repeats
+            Module* m = *find_if(modules.begin(), modules.end(), [&](Module* m) { return not pending[m].empty(); });
+            vector<Module*> path = {};
+            while (find(path.begin(), path.end(), m) == path.end()) {
+                path.push_back(m);
+                auto import = find_if(m->imports.begin(), m->imports.end(), [&](Import& i) {
+                    return pending[m].count(i.module) > 0;
+                });
+                // only waiting for lang, which can not be part of the cycle itself
+                m = import != m->imports.end() ? import->module : lang;
+            }
+            vector<Module*> cycle(find(path.begin(), path.end(), m), path.end());
+            string          chain = "";
+            for (Module* c : cycle) { chain += c->module_name + " -> "; }
+            Module* last   = cycle.back();
+            last->clean    = false; // its interface would lose the location of the import
+            auto    import = find_if(last->imports.begin(), last->imports.end(), [&](Import& i) {
+                return i.module == cycle.front();
+            });
+            parser::error(parser::errors["Circular import"],
+                          import->tokens,
+                          "module "_s + cycle.front()->module_name + " imports itself: " + chain +
+                              cycle.front()->module_name);
+            // build the first module of the cycle as if the rest of the cycle was not there
+            pending[cycle.front()].clear();
+            ready.push_back(cycle.front());
+        }
+        sort(ready.begin(), ready.end(), [&](Module* a, Module* b) { return order[a] < order[b]; });
+        for (Module* m : ready) { m->level = levels.size(); }
+        levels.push_back(ready);
+        placed += ready.size();
+
+        vector<Module*> next = {};
+        for (Module* m : ready) {
+            for (Module* d : dependents[m]) {
+                if (pending[d].erase(m) > 0 and pending[d].empty()) { next.push_back(d); }
+            }
+        }
+        ready = std::move(next);
+    }
+
+    modules.clear();
+    for (vector<Module*>& level : levels) { modules.insert(modules.end(), level.begin(), level.end()); }
+    return levels;
 }
 
 /**
- * @brief get a symbol list for an import. Meta-function. Prefer not to use.
+ * @brief get the names of an import list: the tokens between the braces of `import a: {x, y}`
+ *
+ * @return nullopt if the tokens are not a list of names
  */
 optional<vector<string>> getImportList(lexer::TokenStream t) {
     if (t.size() == 0) { return {}; }
@@ -230,147 +507,607 @@ optional<vector<string>> getImportList(lexer::TokenStream t) {
 
     lexer::Token::Type last = lexer::Token::Type::COMMA;
 
-    for (lexer::Token tok : *t.tokens) {
-        if (tok.type == lexer::Token::Type::COMMA) {};
-        if (tok.type == lexer::Token::Type::SYMBOL) {
-            if (last == lexer::Token::Type::COMMA) {
-                out.push_back(tok.value);
-            } else {
-                return {};
-            }
-        } else {
+    for (usize i = 0; i < t.size(); i++) {
+        if (t[i].type == lexer::Token::Type::SYMBOL and last == lexer::Token::Type::COMMA) {
+            out.push_back(string(t[i].value()));
+        } else if (t[i].type != lexer::Token::Type::COMMA or last != lexer::Token::Type::SYMBOL) {
             return {};
         }
-        last = tok.type;
+        last = t[i].type;
     }
+    if (last == lexer::Token::Type::COMMA) { return {}; }
     return out;
 }
 
+/**
+ * @brief resolve an import statement and remember the imported module
+ *
+ * @param cmd the statement, starting with the `import` token
+ */
+void Module::importStatement(lexer::TokenStream cmd) {
+    lexer::TokenStream import_content = cmd.slice(1, cmd.size());
+
+    string alias = "";
+
+    lexer::TokenStream::Match m = import_content.splitStack({lexer::Token::AS});
+    if (m.found()) {
+        DEBUG(5, "import as found at "_s + to_string(m));
+        lexer::TokenStream alias_stream = m.after();
+        import_content                  = m.before();
+        if (alias_stream.size() == 1 and alias_stream[0].type == lexer::Token::SYMBOL) {
+            alias = alias_stream[0].value();
+            DEBUG(3, "import alias: "_s + alias);
+        }
+    }
+
+    // an import list only registers the module, it is loaded once one of the names is resolved
+    optional<vector<string>>  symbols = nullopt;
+    lexer::TokenStream::Match list    = import_content.splitStack({lexer::Token::IN});
+    if (list.found()) {
+        lexer::TokenStream block = list.after();
+        import_content           = list.before();
+        if (block.size() >= 2 and block[0].type == lexer::Token::BLOCK_OPEN and
+            block[-1].type == lexer::Token::BLOCK_CLOSE) {
+            symbols = getImportList(block.slice(1, block.size() - 1));
+        }
+        if (not symbols) {
+            clean = false;
+            parser::error(parser::errors["Expected list of names"], block, "expected an import list like {a, b}");
+            return;
+        }
+    }
+
+    DEBUG(4, "import_content: "_s + str(import_content));
+    vector<lexer::TokenStream> parts =
+        import_content.list({lexer::Token::SUBNS}, false, "(sub)module name");
+    if (parts.size() > 0) {
+        DEBUG(3, "import parts: "_s + to_string(parts.size()));
+        string         modname;
+        vector<string> includes;
+        bool           break_case = false;
+
+        for (usize j = 0; j < parts.size() - 1; j++) {
+            if (parts[j].size() == 1) {
+                if (parts[j][0].type == lexer::Token::SYMBOL ||
+                    parts[j][0].type == lexer::Token::DOTDOT) {
+                    modname += string(parts[j][0].value()) + "::";
+                }
+            } else {
+                break_case = true;
+            }
+        }
+        if (!break_case or parts.size() == 1) {
+            lexer::TokenStream t = parts[parts.size() - 1];
+            DEBUG(5, "import final part: "_s + str(t));
+            DEBUG(5, "import first part: "_s + str(parts[0]) + "/" + to_string(parts[0][0].type));
+            if (t.size() == 1) {
+                if (t[0].type == lexer::Token::SYMBOL) { modname += t[0].value(); }
+            }
+            if (modname != "") {
+                DEBUG(2, "modname: "_s + modname);
+                DEBUG(4, "import_content: "_s + str(import_content));
+                // the imports of a lazy module are only needed once it is used itself
+                Module* m = Module::create(
+                    modname, "", cst_file, false, import_content, false, false, lazy or symbols.has_value());
+                if (m == nullptr) {
+                    clean = false;
+                } else if (symbols) {
+                    lazy_imports.push_back({modname, m, import_content, modname, *symbols});
+                } else {
+                    imports.push_back({alias == "" ? modname : alias, m, import_content, modname});
+                }
+            }
+        }
+    }
+}
+
 /**
  * @brief tokenize this module and parse for imports to include them
  */
 void Module::preprocess() {
-    ifstream f(cst_file.string());
-    string   content = string(istreambuf_iterator<char>(f), istreambuf_iterator<char>());
+    clean           = true;
+    auto    started = chrono::steady_clock::now();
+    float64 lexed   = 0; ///< seconds spent in the lexers
+    auto    measure = [&]() { // the module is done, whichever way it was read
+        stats.lex        = lexed;
+        stats.preprocess = chrono::duration<float64>(chrono::steady_clock::now() - started).count() - lexed;
+        stats.tokens     = tokens.tokens == nullptr ? 0 : tokens.size(); // none for an interface
+        stats.bytes      = 0;
+        for (lexer::Source* source : sources) { stats.bytes += source->text.size(); }
+    };
 
-    tokens             = lexer::tokenize(content, cst_file);
-    usize macro_passes = 0;
+    // an unchanged header is not read at all, its interface has the symbols dependents need
+    if (isHeader() and not is_main_file and loadInterface()) {
+        DEBUG(3, "preprocessor: "_s + fillup(module_name, 50) + " - interface");
+        measure();
+        return;
+    }
 
-    usize macros_edited = 1;
-    usize cmd_begin     = 0;
-    while (macros_edited) {
-        macros_edited = 0;
-
-        for (usize i = 0; i < tokens.size(); i++) {
-            if (i < tokens.size() - 1) {
-                if (tokens[i].type == lexer::Token::INCLUDE and tokens[i + 1].type == lexer::Token::STRING) {
-                    std::fs::path include_file_path =
-                        std::fs::path(directory.string() + "/" + mod2Path(module_name)).parent_path();
-                    include_file_path += "/"_s + tokens[i + 1].value.substr(1, tokens[i + 1].value.size() - 2);
-                    if (fs::exists(include_file_path)) {
-                        DEBUG(4, "including: "_s + include_file_path.string());
-                        ifstream           f(include_file_path.string());
-                        string             c = string(istreambuf_iterator<char>(f), istreambuf_iterator<char>());
-                        lexer::TokenStream new_tokens = lexer::tokenize(c, include_file_path.string());
-                        tokens.include(i, i+2, new_tokens);
-
-                        f.close();
-                    } else {
-                        parser::error(parser::errors["File not found"],
-                                      tokens.slice(i, i + 2),
-                                      "file at "_s + include_file_path.string() + " was not found!");
-                        tokens.cut(i, i + 2);
-                    }
-                    macros_edited++;
-                    break;
+    // an unchanged module only has its imports resolved again
+    if (optional<lexer::TokenCache::Entry> cached = lexer::token_cache.load(cst_file.string())) {
+        tokens  = lexer::TokenStream(cached->tokens);
+        sources = cached->sources;
+        for (auto [start, stop] : cached->marks) { importStatement(tokens.slice(start, stop)); }
+        DEBUG(3, "preprocessor: "_s + fillup(module_name, 50) + " - cached");
+        measure();
+        return;
+    }
+
+    // tokens are lexed on demand, so imports are resolved while the rest of the file is lexed.
+    // Every source is a piece with its own lexer, an include pushes a new piece that is lexed in place
+    struct Piece {
+            uptr<lexer::Lexer> lexer;
+            usize              begin; ///< index of the first token of this piece in tokens
+    };
+    vector<Piece> pieces      = {};
+    vector<usize> open_groups = {}; ///< brackets in tokens waiting for their partner
+    bool          aborted     = false;
+
+    sources                                   = {&session.source_manager.load(cst_file)};
+    vector<pair<uint32, uint32>> import_marks = {};
+    uint64                       diagnostics  = 0; ///< issued while lexing and including, they keep this from the cache
+    pieces.push_back({make_unique<lexer::Lexer>(*sources[0]), 0});
+    tokens = lexer::TokenStream(make_shared<vector<lexer::Token>>());
+
+    auto lexedUpTo = [&](usize i) { // check if there is a token at i, lex until there is one
+        lexer::Token token;
+        uint64       issued_before = parser::issued;
+        while (tokens.size() <= i and not pieces.empty()) {
+            if (not pieces.back().lexer->next(token)) {
+                if (pieces.back().lexer->aborted()) { // drop what was lexed from this piece
+                    aborted |= pieces.size() == 1;
+                    tokens.tokens->resize(pieces.back().begin);
+                    tokens.stop = tokens.tokens->size();
+                    while (not open_groups.empty() and open_groups.back() >= tokens.size()) { open_groups.pop_back(); }
                 }
+                lexed += pieces.back().lexer->time();
+                pieces.pop_back();
+                continue;
             }
-            if (tokens[i].type == lexer::Token::BLOCK_OPEN or tokens[i].type == lexer::Token::BLOCK_CLOSE) {
-                cmd_begin = i + 1;
+            // the lexers match brackets per piece, match them again across pieces
+            if (lexer::opensGroup(token.type)) {
+                token.partner = 0;
+                open_groups.push_back(tokens.size());
+            } else if (lexer::closesGroup(token.type)) {
+                token.partner = 0;
+                if (not open_groups.empty()) {
+                    token.partner = (*tokens.tokens)[open_groups.back()].partner = tokens.size() - open_groups.back();
+                    open_groups.pop_back();
+                }
             }
-            if (tokens[i].type == lexer::Token::END_CMD) {
-                lexer::TokenStream cmd = tokens.slice(cmd_begin, i);
-                DEBUG(2, str(cmd));
-
-                if (cmd[0].type == lexer::Token::IMPORT) {
-                    lexer::TokenStream import_content = cmd.slice(1, cmd.size());
-
-                    string alias = "";
-
-                    lexer::TokenStream::Match m = import_content.splitStack({lexer::Token::AS});
-                    if (m.found()) {
-                        DEBUG(5, "import as found at "_s + to_string(m));
-                        lexer::TokenStream alias_stream = m.after();
-                        import_content                  = m.before();
-                        if (alias_stream.size() == 1 and alias_stream[0].type == lexer::Token::SYMBOL) {
-                            alias = alias_stream[0].value;
-                            DEBUG(3, "import alias: "_s + alias);
-                        }
-                    }
-
-                    DEBUG(4, "import_content: "_s + str(import_content));
-                    vector<lexer::TokenStream> parts =
-                        import_content.list({lexer::Token::SUBNS}, false, "(sub)module name");
-                    if (parts.size() > 0) {
-                        DEBUG(3, "import parts: "_s + to_string(parts.size()));
-                        string         modname;
-                        vector<string> includes;
-                        bool           break_case = false;
-
-                        for (usize j = 0; j < parts.size() - 1; j++) {
-                            if (parts[j].size() == 1) {
-                                if (parts[j][0].type == lexer::Token::SYMBOL ||
-                                    parts[j][0].type == lexer::Token::DOTDOT) {
-                                    modname += parts[j][0].value + "::";
-                                }
-                            } else {
-                                break_case = true;
-                            }
-                        }
-                        if (!break_case or parts.size() == 1) {
-                            lexer::TokenStream t = parts[parts.size() - 1];
-                            DEBUG(5, "import final part: "_s + str(t));
-                            DEBUG(5, "import first part: "_s + str(parts[0]) + "/" + to_string(parts[0][0].type));
-                            if (t.size() == 1) {
-                                if (t[0].type == lexer::Token::SYMBOL) { modname += t[0].value; }
-                            } else if (t.size() >= 3) {
-                                if (t[0].type == lexer::Token::IN and t[1].type == lexer::Token::BLOCK_OPEN and
-                                    t[-1].type == lexer::Token::BLOCK_CLOSE) {
-                                    if (modname != "") { modname = modname.substr(2); }
-                                }
-                            }
-                            if (modname != "") {
-                                DEBUG(2, "modname: "_s + modname);
-                                DEBUG(4, "import_content: "_s + str(import_content));
-                                Module* m = Module::create(modname, "", cst_file, false, import_content);
-                                if (m != nullptr) { add(alias == "" ? modname : alias, m); }
-                            }
-                        }
-                    }
+            tokens.tokens->push_back(token);
+            tokens.stop++;
+        }
+        diagnostics += parser::issued - issued_before;
+        return i < tokens.size();
+    };
+    usize macro_passes = 0;
+    usize includes     = 0;
+    usize cmd_begin    = 0;
+
+    // single forward pass, the stack of pieces is the worklist. Every token and import statement is seen once
+    for (usize i = 0; lexedUpTo(i); i++) {
+        if (lexedUpTo(i + 1)) {
+            if (tokens[i].type == lexer::Token::INCLUDE and tokens[i + 1].type == lexer::Token::STRING) {
+                // relative to the file of this module
+                string        included          = string(tokens[i + 1].value().substr(1, tokens[i + 1].length - 2));
+                std::fs::path include_file_path = cst_file.parent_path().string() + "/" + included;
+                // tokens are pulled one at a time, so the include statement is at the end of tokens
+                if (stat_cache.exists(include_file_path)) {
+                    DEBUG(4, "including: "_s + include_file_path.string());
+                    lexer::Source& source = session.source_manager.load(include_file_path.string());
+                    source.included_from  = make_shared<lexer::TokenStream>(tokens.slice(i, i + 2).copy());
+                    sources.push_back(&source);
+                    pieces.push_back({make_unique<lexer::Lexer>(source), i});
+                } else {
+                    diagnostics++;
+                    parser::error(parser::errors["File not found"],
+                                  tokens.slice(i, i + 2),
+                                  "file at "_s + include_file_path.string() + " was not found!");
                 }
+                tokens.tokens->resize(i);
+                tokens.stop = i;
+                includes++;
+                i--; // continue scanning at the splice point
+                continue;
+            }
+        }
+        // the braces of an import list are part of the import statement
+        if ((tokens[i].type == lexer::Token::BLOCK_OPEN or tokens[i].type == lexer::Token::BLOCK_CLOSE) and
+            tokens[cmd_begin].type != lexer::Token::IMPORT) {
+            cmd_begin = i + 1;
+        }
+        if (tokens[i].type == lexer::Token::END_CMD) {
+            lexer::TokenStream cmd = tokens.slice(cmd_begin, i);
+            DEBUG(2, str(cmd));
+
+            if (cmd[0].type == lexer::Token::IMPORT) {
+                import_marks.push_back({cmd_begin, i});
+                importStatement(cmd);
+            }
+
+            cmd_begin = i + 1;
+        }
+    }
+    macro_passes++;
+    if (aborted) {
+        session.source_manager.release(tokens.tokens);
+        tokens = lexer::TokenStream(make_shared<vector<lexer::Token>>());
+    }
+    clean = clean and not aborted and diagnostics == 0;
+    if (not aborted and diagnostics == 0) { // diagnostics would get lost when the tokens are loaded from the cache
+        lexer::token_cache.store(cst_file.string(), sources, *tokens.tokens, import_marks);
+    }
+    DEBUG(3,
+          "preprocessor: "_s + fillup(module_name, 50) + " - macro passes:" + to_string(macro_passes) +
+              ", includes:" + to_string(includes));
+    measure();
+}
 
-                cmd_begin = i + 1;
+/**
+ * @brief load the symbols and imports of a header module from its precompiled interface
+ *
+ * @return false if there is no up-to-date interface
+ */
+bool Module::loadInterface() {
+    optional<symbol::InterfaceCache::Interface> interface = symbol::interface_cache.load(hst_file.string(), *this);
+    if (not interface) { return false; }
+    for (symbol::InterfaceCache::Import& import : interface->imports) {
+        Module* m = Module::create(import.name, "", cst_file, false, lexer::TokenStream::none(), false, false, lazy);
+        if (m == nullptr) { // the imported module is gone, read the header again to report it
+            for (auto& [key, symbols] : contents) {
+                for (symbol::Reference* symbol : symbols) { delete symbol; }
             }
+            contents.clear();
+            imports.clear();
+            return false;
         }
-        macro_passes++;
+        imports.push_back({import.alias, m, lexer::TokenStream::none(), import.name});
+    }
+    // not read, only an incremental build hashes them
+    interface_sources = interface->sources;
+    from_interface = true;
+    return true;
+}
+
+/**
+ * @brief write the precompiled interface of a header module, if it was preprocessed without diagnostics
+ */
+void Module::storeInterface() {
+    // import lists are not part of an interface, the names would not be found through it
+    if (from_interface or not clean or is_main_file or not isHeader() or not lazy_imports.empty()) { return; }
+    vector<symbol::InterfaceCache::Import> interface_imports = {};
+    for (Import& import : imports) { interface_imports.push_back({import.name, import.alias}); }
+    symbol::interface_cache.store(hst_file.string(), sources, *this, interface_imports);
+}
+
+void Module::declare() {
+    lock_guard<mutex> guard(declare_lock);
+    if (declared or not lazy) { return; }
+    declared = true;
+    CompilationSession::Scope scope(session); // resolved while another session compiles, e.g. a shared one
+    preprocess();
+    storeInterface();
+    for (Import& import : imports) { add(import.alias, import.module); }
+    linked = true;
+    DEBUG(3, "declared lazy module: "_s + module_name);
+}
+
+void Module::require() {
+    bool preprocessed = false;
+    {
+        lock_guard<mutex> guard(declare_lock);
+        if (not lazy) { return; }
+        lazy         = false;
+        preprocessed = declared;
+    }
+    if (not preprocessed) {
+        session.submit([this]() { preprocess(); });
+        return;
+    }
+    // it was used already, only its imports were left lazy
+    for (Import& import : imports) {
+        if (&import.module->session == &session) { import.module->require(); }
+    }
+}
+
+vector<symbol::Reference*> Module::getLocal(string subloc) {
+    if (lazy) { declare(); }
+    vector<symbol::Reference*> result = Namespace::getLocal(subloc);
+    if (not result.empty()) { return result; }
+    string head = subloc.substr(0, subloc.find("::"));
+    for (Import& import : lazy_imports) {
+        if (find(import.symbols.begin(), import.symbols.end(), head) == import.symbols.end()) { continue; }
+        result = import.module->getLocal(subloc);
+        if (not result.empty()) { break; }
     }
-    f.close();
-    DEBUG(3, "preprocessor: "_s + fillup(module_name, 50) + " - macro passes:" + to_string(macro_passes));
+    return result;
 }
 
 /**
  * @brief parse this module and create AST nodes
  */
 void Module::parse() {
-    /*sptr<AST> root = SubBlockAST::parse(tokens, 0, this);
-    if (root != nullptr) {
-        int* i = new int;
-        *i     = 0;
-        // cout << str(root.get()) << endl;
-        cout << root->emitCST() << endl;
+    auto   started       = chrono::steady_clock::now();
+    uint64 issued_before = parser::issued;
+    if (not from_interface) { // modules loaded from their interface have their symbols already
+        /*sptr<AST> root = SubBlockAST::parse(tokens, 0, this);
+        if (root != nullptr) {
+            int* i = new int;
+            *i     = 0;
+            // cout << str(root.get()) << endl;
+            cout << root->emitCST() << endl;
+
+            delete i;
+        }*/
+    }
+    clean = clean and parser::issued == issued_before;
+
+    // what dependents see of this module: its header and its symbols
+    interface_hash = symbol::InterfaceCache::hash(*this);
+    if (isHeader()) { interface_hash = hashFile(hst_file.string(), interface_hash); }
+    stats.parse = chrono::duration<float64>(chrono::steady_clock::now() - started).count();
+
+    lock_guard<mutex> guard(session.progress_lock);
+    cout << "\rParsing modules (" << ++session.parsed_modules << "/" << session.modules.size() << ")";
+}
+
+uint64 Module::contentHash() const {
+    uint64 hash = fnv1a(module_name);
+    if (isHeader()) { hash = hashFile(hst_file.string(), hash); }
+    for (lexer::Source* source : sources) { hash = fnv1a(source->text, fnv1a(source->name, hash)); }
+    for (const string& source : interface_sources) { hash = hashFile(source, fnv1a(source, hash)); }
+    return hash;
+}
+
+uint64 Module::importedHash() const {
+    if (not lazy) { return interface_hash; }
+    // never built, what importers may use of it is in its files
+    uint64 hash = fnv1a(module_name);
+    if (isHeader()) { hash = hashFile(hst_file.string(), hash); }
+    if (isKnown()) { hash = hashFile(cst_file.string(), hash); }
+    return hash;
+}
+
+vector<Module*> Module::dependencies() const {
+    vector<Module*> out = {};
+    auto            add = [&](Module* m) {
+        // modules of the same or a later level were only imported through a cycle that was broken up.
+        // Modules of a shared session were built before
+        // Lazy modules are not built at all
+        if (m == nullptr or (&m->session == &session and not m->lazy and m->level >= level)) { return; }
+        if (find(out.begin(), out.end(), m) == out.end()) { out.push_back(m); }
+    };
+    for (const Import& import : imports) { add(import.module); }
+    for (const Import& import : lazy_imports) { add(import.module); }
+    for (symbol::Namespace* ns : include) { add(dynamic_cast<Module*>(ns)); }
+    return out;
+}
+
+bool Module::upToDate(const BuildDatabase& database) {
+    content_hash                         = contentHash();
+    optional<BuildDatabase::Record> last = database.find(module_name);
+    if (not clean or not last or last->content_hash != content_hash) { return false; }
+
+    vector<Module*> deps = dependencies();
+    if (deps.size() != last->dependencies.size()) { return false; }
+    for (usize i = 0; i < deps.size(); i++) {
+        if (deps[i]->module_name != last->dependencies[i].first or
+            deps[i]->importedHash() != last->dependencies[i].second) {
+            return false;
+        }
+    }
+    interface_hash = last->interface_hash;
+    stats.parse    = 0;
+    return true;
+}
+
+void Module::record(BuildDatabase& database) const {
+    if (not clean) { return; }
+    BuildDatabase::Record record = {content_hash, interface_hash, {}};
+    for (Module* dep : dependencies()) { record.dependencies.push_back({dep->module_name, dep->importedHash()}); }
+    database.record(module_name, record);
+}
+
+
+TEST_CASE ("Testing Module::buildLevels", "[modules]") {
+    fs::path dir = fs::temp_directory_path() / "cstc_levels_test";
+    fs::create_directories(dir);
+    map<string, string> files = {
+        {"a", "import b;\nimport c;\n"},
+        {"b", "import d;\n"},
+        {"c", "import d;\n"},
+        {"d", ""},
+        {"e", "import f;\n"},
+        {"f", "import e;\n"},
+    };
+    for (auto& [name, contents] : files) { ofstream(dir / (name + ".cst")) << contents; }
+
+    CompilationSession        session;
+    CompilationSession::Scope scope(session);
+    parser::mute();
+    Module* a = Module::create("a", "", (dir / "main.cst").string(), false, lexer::TokenStream::none(), true);
+    Module* e = Module::create("e", "", (dir / "main.cst").string(), false, lexer::TokenStream::none(), true);
+    Module::awaitFetched();
+    vector<vector<Module*>> levels = Module::buildLevels();
+
+    string prefix = a->module_name.substr(0, a->module_name.size() - 1);
+    auto   module = [&](string name) { return session.known_modules[prefix + name]; };
+    REQUIRE(levels.size() == 5);
+    REQUIRE(levels[0] == vector<Module*>{module("d")});
+    REQUIRE((levels[1] == vector<Module*>{module("b"), module("c")}));
+    REQUIRE(levels[2] == vector<Module*>{a});
+    // the cycle is reported once and broken up at its first module
+    REQUIRE(session.errc == 1);
+    REQUIRE(levels[3] == vector<Module*>{module("f")});
+    REQUIRE(levels[4] == vector<Module*>{e});
+    REQUIRE(session.modules.size() == 6);
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE ("Testing Module::refresh", "[modules]") {
+    fs::path dir = fs::temp_directory_path() / "cstc_refresh_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    ofstream(dir / "a.cst") << "import b;\n";
+    ofstream(dir / "b.cst") << "include \"c.txt\"\n";
+    ofstream(dir / "c.txt") << "x = 1;\n";
+    stat_cache.clear();
+
+    CompilationSession        session;
+    CompilationSession::Scope scope(session);
+    Module* a = Module::create("a", "", (dir / "main.cst").string(), false, lexer::TokenStream::none(), true);
+    Module::awaitFetched();
+    Module* b = session.known_modules.at(a->module_name.substr(0, a->module_name.size() - 1) + "b");
+    REQUIRE(session.source_manager.size() == 3);
+    usize kept = session.source_manager.keptTokens();
 
-        delete i;
-    }*/
-    cout << "\rParsing modules (" << ++parsed_modules << "/" << Module::modules.size() << ")";
+    // a module read again frees what it was read from before
+    for (usize i = 0; i < 3; i++) {
+        Module::refresh({b->files().back()});
+        Module::awaitFetched();
+    }
+    REQUIRE(session.errc == 0);
+    REQUIRE(session.source_manager.size() == 3);
+    REQUIRE(session.source_manager.keptTokens() == kept);
+
+    Module::clear();
+    REQUIRE(session.source_manager.size() == 0);
+    REQUIRE(session.source_manager.keptTokens() == 0);
+    fs::remove_all(dir);
+}
+
+TEST_CASE ("Testing includes", "[modules]") {
+    fs::path dir = fs::temp_directory_path() / "cstc_include_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir / "sub");
+    ofstream(dir / "a.cst") << "include \"a.txt\"\n";
+    ofstream(dir / "a.txt") << "x = 1;\n";
+    ofstream(dir / "sub" / "b.cst") << "include \"b.txt\"\n";
+    ofstream(dir / "sub" / "b.txt") << "y = 2;\n";
+    stat_cache.clear();
+
+    // fetched at the same time, every module finds the files next to it
+    CompilationSession        session;
+    CompilationSession::Scope scope(session);
+    Module::create("a", "", (dir / "main.cst").string(), false, lexer::TokenStream::none(), true);
+    Module::create("b", "", (dir / "sub" / "main.cst").string(), false, lexer::TokenStream::none(), true);
+    Module::awaitFetched();
+    REQUIRE(session.errc == 0);
+    REQUIRE(session.source_manager.size() == 4);
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE ("Testing -1 with an error in an imported module", "[modules]") {
+    fs::path dir = fs::temp_directory_path() / "cstc_one_error_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    ofstream(dir / "a.cst") << "import b;\n";
+    ofstream(dir / "b.cst") << "import nope;\nimport nada;\n";
+    stat_cache.clear();
+
+    // the error is raised by a job, the session stops instead of exiting the process
+    CompilationSession        session;
+    CompilationSession::Scope scope(session);
+    session.muted     = true;
+    session.one_error = true;
+    Module::create("a", "", (dir / "main.cst").string(), false, lexer::TokenStream::none(), true);
+    Module::awaitFetched();
+    REQUIRE(session.stopped);
+    REQUIRE(session.errc == 1);
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE ("Testing incremental builds", "[modules]") {
+    fs::path dir = fs::temp_directory_path() / "cstc_incremental_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    ofstream(dir / "a.cst") << "import b;\n";
+    ofstream(dir / "b.cst") << "x = 1;\n";
+
+    // build like main does and get the modules of the test that were parsed
+    string prefix = "";
+    auto   build  = [&]() {
+        CompilationSession        session; // every build is a new compiler run
+        CompilationSession::Scope scope(session);
+        stat_cache.clear();
+        Module* a = Module::create("a", "", (dir / "main.cst").string(), false, lexer::TokenStream::none(), true);
+        prefix    = a->module_name.substr(0, a->module_name.size() - 1);
+        Module::awaitFetched();
+        BuildDatabase  database(dir.string());
+        vector<string> parsed = {};
+        for (vector<Module*>& level : Module::buildLevels()) {
+            for (Module* m : level) {
+                if (not m->upToDate(database)) {
+                    m->parse();
+                    if (m->module_name.starts_with(prefix)) { parsed.push_back(m->module_name.substr(prefix.size())); }
+                }
+                m->record(database);
+            }
+        }
+        // hashing headers and files does not keep them, only the two modules were read
+        REQUIRE(session.source_manager.size() == 2);
+        REQUIRE(database.save());
+        return parsed;
+    };
+
+    REQUIRE((build() == vector<string> {"b", "a"}));
+    REQUIRE(build().empty());
+    // an implementation change only rebuilds the module itself
+    ofstream(dir / "b.cst") << "x = 2;\n";
+    REQUIRE(build() == vector<string> {"b"});
+    // a header is part of the interface, its dependents are rebuilt
+    ofstream(dir / "b.hst") << "x;\n";
+    REQUIRE((build() == vector<string> {"b", "a"}));
+    REQUIRE(build().empty());
+
+    fs::remove_all(dir);
 }
 
+TEST_CASE ("Testing lazy imports", "[modules]") {
+    fs::path dir = fs::temp_directory_path() / "cstc_lazy_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    ofstream(dir / "a.cst") << "import b: {c, d};\nimport e: {f};\n";
+    ofstream(dir / "b.cst") << "import c;\ninclude \"missing.txt\"\n";
+    ofstream(dir / "c.cst") << "include \"missing.txt\"\n";
+    ofstream(dir / "e.cst") << "include \"missing.txt\"\n";
+    ofstream(dir / "g.cst") << "import c;\n";
+    stat_cache.clear();
+
+    CompilationSession        session;
+    CompilationSession::Scope scope(session);
+    parser::mute();
+    Module* a = Module::create("a", "", (dir / "main.cst").string(), false, lexer::TokenStream::none(), true);
+    Module::awaitFetched();
+    Module::buildLevels();
+
+    string prefix = a->module_name.substr(0, a->module_name.size() - 1);
+    auto   module = [&](string name) { return session.known_modules.at(prefix + name); };
+    // the imported modules are registered, but not read and not built
+    REQUIRE(session.known_modules.size() == 3);
+    REQUIRE(session.modules == list<Module*> {a});
+    REQUIRE(session.errc == 0);
+
+    // names that are not listed do not load anything
+    REQUIRE((*a)["y"].empty());
+    REQUIRE(session.errc == 0);
+    // resolving a listed name reads its module, whose imports are lazy as well
+    vector<symbol::Reference*> c = (*a)["c"];
+    REQUIRE(session.errc == 1);
+    REQUIRE(c == vector<symbol::Reference*> {module("c")});
+    REQUIRE((*a)["d"].empty());
+    REQUIRE(session.errc == 1);
+    REQUIRE(session.known_modules.size() == 4);
+
+    // an import without a list makes a lazy module part of the build
+    Module* g = Module::create("g", "", (dir / "main.cst").string(), false, lexer::TokenStream::none(), true);
+    Module::awaitFetched();
+    REQUIRE(session.errc == 2);
+    REQUIRE((session.modules == list<Module*> {a, module("c"), g}));
+
+    fs::remove_all(dir);
+}
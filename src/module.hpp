@@ -5,13 +5,18 @@
 //
 // layouts the module class
 //
+#include "helpers/build_db.hpp"
 #include "lexer/token.hpp"
 #include "parser/symboltable.hpp"
+#include "session.hpp"
 
+#include <atomic>
 #include <filesystem>
 #include <list>
 #include <map>
+#include <mutex>
 #include <optional>
+#include <set>
 #include <vector>
 
 namespace std {
@@ -22,11 +27,81 @@ namespace std {
 /// \class Module holds all information and contents of a Program module
 ///
 class Module final : public symbol::Namespace {
+        CompilationSession&  session;                               //> compilation this module belongs to
         bool                 is_main_file = false;                  //> whether this is the main module
         bool                 is_stdlib    = false;                  //> whether this is a stdlib module
         map<string, Module*> deps         = {};                     //> dependency modules
         lexer::TokenStream   tokens       = lexer::TokenStream({}); //> this module's tokens
 
+        ///
+        /// \brief an import statement of this module
+        ///
+        struct Import {
+                string             alias;        //> name the module is added as
+                Module*            module;       //> imported module
+                lexer::TokenStream tokens;       //> imported module name, for diagnostics
+                string             name;         //> imported module name, as written
+                vector<string>     symbols = {}; //> names of an import list: `import a: {x, y}`
+        };
+
+        vector<Import>         imports           = {};    //> imported modules, in source order
+        vector<Import>         lazy_imports      = {};    //> imports with an import list, resolved through getLocal()
+        vector<lexer::Source*> sources           = {};    //> sources the tokens were read from
+        vector<string>         interface_sources = {};    //> sources of a module loaded from its interface, not read
+        bool                   clean             = false; //> preprocessed without diagnostics
+        bool                   from_interface    = false; //> symbols were loaded from a precompiled interface
+        bool                   linked            = false; //> imported modules were added to this module
+        usize                  level             = 0;     //> build level, set by buildLevels()
+        uint64                 content_hash      = 0;     //> hash of the header and sources
+        uint64                 interface_hash    = 0;     //> hash of the exported symbols, set once built
+        atomic<bool>           lazy              = false; //> only imported through import lists, not built
+        bool                   declared          = false; //> a lazy module was preprocessed, guarded by declare_lock
+        mutex                  declare_lock;
+
+        /**
+         * @brief resolve an import statement and remember the imported module
+         */
+        void importStatement(lexer::TokenStream cmd);
+
+        /**
+         * @brief load the symbols and imports of a header module from its precompiled interface
+         *
+         * @return false if there is no up-to-date interface
+         */
+        bool loadInterface();
+
+        /**
+         * @brief preprocess a lazy module once one of its symbols is resolved. Its own imports are lazy as well, they
+         * are added to it right away
+         */
+        void declare();
+
+        /**
+         * @brief preprocess a lazy module for the build, because it was imported without an import list
+         */
+        void require();
+
+        /**
+         * @brief get the hash importers record for this module: the hash of its interface once built, the hash of
+         * its files if it is lazy
+         */
+        uint64 importedHash() const;
+
+        /**
+         * @brief hash the header and the sources of this module
+         */
+        uint64 contentHash() const;
+
+        /**
+         * @brief remove the imported modules added by awaitFetched() from this module, without deleting them
+         */
+        void unlink();
+
+        /**
+         * @brief drop everything preprocessing and parsing found, so the module can be preprocessed again
+         */
+        void reset();
+
     protected:
         /**
          * @brief get a visual representation of this Object
@@ -34,16 +109,33 @@ class Module final : public symbol::Namespace {
         string _str() const;
 
     public:
-        string          module_name; //> representation module name
-        static fs::path directory;   //> main program directory
-        fs::path        hst_file;    //> header location (relative)
-        fs::path        cst_file;    //> source location (relative)
+        /**
+         * @brief what fetching and building a module took, for the module graph
+         */
+        struct Stats {
+                float64 lex        = 0; //> seconds spent lexing, includes too
+                float64 preprocess = 0; //> seconds spent preprocessing, without lexing
+                float64 parse      = 0; //> seconds spent parsing, 0 if it was up to date
+                usize   tokens     = 0; //> tokens of the module
+                usize   bytes      = 0; //> size of the sources read, 0 if loaded from an interface
+        };
+
+        string   module_name; //> representation module name
+        fs::path hst_file;    //> header location (relative)
+        fs::path cst_file;    //> source location (relative)
+        Stats    stats = {};  //> set by preprocess() and parse()
 
         bool isHeader() const;
         bool isKnown() const;
 
         const string getName() const { return "Module"; }
 
+        /**
+         * @brief get a symbol of this module. A lazy module is preprocessed first, names of import lists are looked up
+         * in their module
+         */
+        vector<symbol::Reference*> getLocal(string subloc) override;
+
         /**
          * @brief tokenize this module and parse for imports to include them
          */
@@ -54,13 +146,57 @@ class Module final : public symbol::Namespace {
          */
         void parse();
 
+        /**
+         * @brief write the precompiled interface of a header module, if it was preprocessed without diagnostics
+         */
+        void storeInterface();
+
+        /**
+         * @brief check if this module is unchanged since the build recorded in a database: its sources are the same
+         * and every module it depends on kept its interface. An up-to-date module takes its interface hash from
+         * the database and does not need to be parsed.
+         */
+        bool upToDate(const BuildDatabase& database);
+
+        /**
+         * @brief record this module in a database, once it was parsed or found up to date. Modules with diagnostics
+         * are not recorded, so they are built again
+         */
+        void record(BuildDatabase& database) const;
+
+        /**
+         * @brief get the modules this module is built after, in a stable order. Set once the modules are sorted into
+         * levels
+         */
+        vector<Module*> dependencies() const;
+
+        /**
+         * @brief get the files this module was read from (header, source and includes), as absolute paths
+         */
+        vector<string> files() const;
+
         Module(string path, string dir, string name, bool is_stdlib = false, bool is_main_file = false);
 
-        static map<string, Module*>
-            known_modules; //> A map of all compile-time known modules to allow faster acces when importing
-        static list<string>
-            unknown_modules;          //> A map of all compile-time unknown modules to allow better error messages
-        static list<Module*> modules; //> A list of all modules loaded. This is used to determine the compile order
+        /**
+         * @brief wait until every created module is preprocessed, then add the imported modules to their importers
+         * and fill modules in dependency order (the order a sequential depth-first fetch would have). Modules of a
+         * shared session are imported, but not part of modules
+         */
+        static void awaitFetched();
+
+        /**
+         * @brief prepare the fetched modules for another compilation in the same process. Modules with a changed
+         * file or diagnostics are preprocessed again, modules whose files are gone are forgotten and their importers
+         * preprocessed again. Call awaitFetched() afterwards, as after create().
+         *
+         * @param changed absolute paths of files that changed since the last compilation
+         */
+        static void refresh(const set<string>& changed);
+
+        /**
+         * @brief forget all modules of the current session, the next compilation fetches everything again
+         */
+        static void clear();
 
         /**
          * @brief get the default stdlib location using the CSTC_STD environment variable
@@ -78,11 +214,13 @@ class Module final : public symbol::Namespace {
         static string mod2Path(string path);
 
         /**
-         * @brief compare two modules about their load order
+         * @brief sort the fetched modules into dependency levels (Kahn's algorithm). A module only depends on modules
+         * of earlier levels, so the modules of a level can be parsed in parallel. Import cycles are reported and
+         * broken up. Refills modules in build order.
          *
-         * @return true, if a should be loaded before b
+         * @return the levels, modules in a level keep their order in modules
          */
-        static bool loadOrder(Module* a, Module* b);
+        static vector<vector<Module*>> buildLevels();
 
         /**
          * @brief return an imported module. This method checks if there already is a module of this name
@@ -95,6 +233,12 @@ class Module final : public symbol::Namespace {
          * @param tokens tokens of the preprocessor-parser, used for error messages
          * @param is_main_file whether this is the main file. should not be set outside the main function.
          * @param from_path create this from a "real path" instead of a module
+         * @param lazy only register the module, it is preprocessed once a symbol is resolved (import lists)
+         *
+         * A new module is created exactly once, even if several modules import it at the same time.
+         * It is preprocessed in a task on the shared ThreadPool, call awaitFetched() before using it.
+         * A lazy module is neither preprocessed nor built, unless it is imported without an import list as well.
+         * Modules are created in the current CompilationSession, unless its shared session has them.
          *
          * @return Newly created Module (Pointer) if succesful or nullptr
          */
@@ -104,11 +248,12 @@ class Module final : public symbol::Namespace {
                               bool                 is_stdlib,
                               lexer::TokenStream   tokens       = lexer::TokenStream::none(),
                               bool                 is_main_file = false,
-                              bool                 from_path    = false);
+                              bool                 from_path    = false,
+                              bool                 lazy         = false);
 };
 
 /**
- * @brief get a symbol list for an import. Meta-function. Prefer not to use.
+ * @brief get the names of an import list: the tokens between the braces of `import a: {x, y}`
  */
 extern optional<vector<string>> getImportList(lexer::TokenStream);
 
@@ -9,6 +9,7 @@
 
 #include "../../debug.hpp"
 #include "../../errors/errors.hpp"
+#include "../../helpers/string_functions.hpp"
 #include "../../lexer/lexer.hpp"
 #include "../../lexer/token.hpp"
 //#include "../parser.hpp"
@@ -21,37 +22,29 @@
 #include <string>
 #include <vector>
 
-bool stringIntBiggerThan(string a, string b) {
-    if (a.size() > b.size()) { return true; }
-    if (b.size() > a.size()) { return false; }
-    for (uint32 i = 0; i < a.size(); i++) {
-        if (a[i] > b[i]) { return true; }
-        if (b[i] > a[i]) { return false; }
-    }
-    return false;
-}
-
 CstType LiteralAST::provide() {
     parser::error(parser::errors["Expression unassignable"], tokens, "Cannot assign an expression result to a value");
     return "@unknown"_c;
 }
 
-IntLiteralAST::IntLiteralAST(int bits, string value, bool tsigned, lexer::TokenStream tokens) {
-    this->bits        = bits;
-    this->const_value = value;
+/// \brief get the biggest magnitude an integer type can hold
+///
+/// \param negative if the magnitude is of a negative value
+uint128 intMagnitudeLimit(int bits, bool tsigned, bool negative) {
+    if (bits >= 128) { return tsigned ? (uint128(1) << 127) - !negative : ~uint128(0); }
+    if (tsigned) { return (uint128(1) << (bits - 1)) - !negative; }
+    return (uint128(1) << bits) - 1;
+}
+
+IntLiteralAST::IntLiteralAST(int bits, lexer::NumericLiteral value, bool tsigned, lexer::TokenStream tokens) {
+    this->value       = value;
+    this->const_value = (tsigned ? "-"s : ""s) + to_string(value.value);
     this->tsigned     = tsigned;
     this->tokens      = tokens;
 
-    // if constant is too big for (u)int32 upgrade to uint64
-    if (bits == 32) {
-        string v = value;
-        if (tsigned) {
-            v = v.substr(1);
-            if (stringIntBiggerThan(v, "2147483648")) { bits = 64; }
-        } else if (stringIntBiggerThan(v, "4294967295")) {
-            bits = 64;
-        }
-    }
+    // if constant is too big for (u)int32 upgrade to (u)int64
+    if (bits == 32 and value.value > intMagnitudeLimit(32, tsigned, tsigned)) { bits = 64; }
+    this->bits = bits;
 }
 
 string IntLiteralAST::emitCST() const {
@@ -69,16 +62,11 @@ sptr<AST> IntLiteralAST::parse(PARSER_FN_PARAM) {
         tokens = tokens.slice(1, tokens.size());
     }
     if (tokens.size() == 1) {
-        if (tokens[0].type == lexer::Token::INT) {
-            return sptr<AST>(new IntLiteralAST(32, tokens[0].value, sign, tokens2));
-        } else if (tokens[0].type == lexer::Token::HEX) {
-            return sptr<AST>(new IntLiteralAST(32, to_string(stoll(tokens[0].value.substr(2), 0, 12)), sign, tokens2));
-        } else if (tokens[0].type == lexer::Token::BINARY) {
-            return sptr<AST>(new IntLiteralAST(32, to_string(stoll(tokens[0].value.substr(2), 0, 2)), sign, tokens2));
+        if (tokens[0].type == lexer::Token::INT or tokens[0].type == lexer::Token::HEX or
+            tokens[0].type == lexer::Token::BINARY) {
+            return sptr<AST>(new IntLiteralAST(32, tokens[0].number(), sign, tokens2));
         }
     }
-
-    // TODO parse binary integers
     return nullptr;
 }
 
@@ -96,33 +84,52 @@ REQUIRE(ast.get() != nullptr);
     }
 }
 
-void IntLiteralAST::consume(CstType type) {
-    regex r("u?int(8|16|32|64|128)");
-    bool expected_int = regex_match(type.toString(), r);
-    if (expected_int || type == "usize"_c || type == "ssize"_c) {
-        bool sig  = type[0] != 'u';
-        int  bits;
-        if (type == "usize"_c || type == "ssize"_c) {
-            bits=64; // TODO
-        } else {
-            bits = std::stoi(type.substr(3 + (!sig), type.size()));
-        }
+TEST_CASE ("Testing IntLiteralAST::parse values", "[literal]") {
+    auto parse = [](string val) { return cast2(IntLiteralAST::parse(lexer::tokenize(val), 0, nullptr), IntLiteralAST); };
+
+    REQUIRE(parse("0x1F")->getValue() == "31");
+    REQUIRE(parse("0b101")->getValue() == "5");
+    REQUIRE(parse("-12")->getValue() == "-12");
+    REQUIRE(parse("4294967295")->getCstType().toString() == "uint32");
+    REQUIRE(parse("4294967296")->getCstType().toString() == "uint64");
+    REQUIRE(parse("-2147483648")->getCstType().toString() == "int32");
+    REQUIRE(parse("-2147483649")->getCstType().toString() == "int64");
+    REQUIRE(parse("0x" + string(40, 'f'))->getValue() == to_string(~uint128(0)));
+}
+
+/// \brief get the size of an integer type
+///
+/// \param sig set to whether the type is signed
+///
+/// \return the size in bits or 0 if type is not an integer type
+int intTypeBits(string_view type, bool& sig) {
+    sig = type[0] != 'u';
+    if (type == "usize" || type == "ssize") { return 64; } // TODO
+    if (not sig) { type.remove_prefix(1); }
+    if (not type.starts_with("int")) { return 0; }
+    type.remove_prefix(3);
+    for (int bits : {8, 16, 32, 64, 128}) {
+        if (type == to_string(bits)) { return bits; }
+    }
+    return 0;
+}
 
-        if (const_value.value()[0] == '-' && !sig) {
+void IntLiteralAST::consume(CstType type) {
+    bool sig;
+    int  bits = intTypeBits(type.toString(), sig);
+    if (bits != 0) {
+        bool negative = const_value.value()[0] == '-';
+        if (negative && !sig) {
             parser::error(parser::errors["Sign mismatch"],
                           {tokens[0], tokens[1]},
                           "Found a signed value (expected \e[1m"s + type + "\e[0m)");
+        } else if (value.overflow or value.value > intMagnitudeLimit(bits, sig, negative)) {
+            parser::warn(parser::warnings["Integer too big"],
+                         tokens,
+                         "trying to fit a number too big into "s + type + ". This will lead to information loss.");
         }
         tsigned    = sig;
         this->bits = bits;
-
-        // TODO fix this
-        // if (StringIntBiggerThan(value.substr(value[0] == '-'),
-        //                        std::to_string((1 << (bits - tsigned)) - (value[0] != '-')))) {
-        //    parser::warn("Integer too big", tokens,
-        //                 "trying to fit a number too big into "s + type + ". This will lead to information loss.",
-        //                 17);
-        //}
     } else if (type != "@unknown"_c) {
         parser::error(parser::errors["Type mismatch"], tokens, "expected a \e[1m"s + type + "\e[0m, found int");
     }
@@ -140,8 +147,8 @@ string BoolLiteralAST::emitCST() const {
 sptr<AST> BoolLiteralAST::parse(lexer::TokenStream tokens, int, symbol::Namespace*, string) {
     DEBUG(4, "Trying BoolLiteralAST::parse");
     if (tokens.size() == 1) {
-        if (tokens[0].value == "true" || tokens[0].value == "false") {
-            return sptr<AST>(new BoolLiteralAST(tokens[0].value, tokens));
+        if (tokens[0].value() == "true" || tokens[0].value() == "false") {
+            return sptr<AST>(new BoolLiteralAST(string(tokens[0].value()), tokens));
         }
     }
     return nullptr;
@@ -187,12 +194,12 @@ sptr<AST> FloatLiteralAST::parse(lexer::TokenStream tokens, int, symbol::Namespa
     if (tokens.size() < 2) { return nullptr; }
     if (tokens.size() > 3) { return nullptr; }
     if (tokens[0].type == lexer::Token::Type::ACCESS && tokens[1].type == lexer::Token::Type::INT) {
-        return sptr<AST>(new FloatLiteralAST(32, (sig ? string("-0.") : string("0.")) + tokens[1].value + "e00", t));
+        return sptr<AST>(new FloatLiteralAST(32, (sig ? string("-0.") : string("0.")) + string(tokens[1].value()) + "e00", t));
     } else if (tokens[0].type == lexer::Token::Type::INT && tokens[1].type == lexer::Token::Type::ACCESS) {
-        string val = (sig ? string("-") : string("")) + tokens[0].value + ".";
+        string val = (sig ? string("-") : string("")) + string(tokens[0].value()) + ".";
         if (tokens.size() == 3) {
             if (tokens[2].type == lexer::Token::Type::INT) {
-                val += tokens[2].value;
+                val += tokens[2].value();
             } else {
                 return nullptr;
             }
@@ -204,10 +211,12 @@ sptr<AST> FloatLiteralAST::parse(lexer::TokenStream tokens, int, symbol::Namespa
 }
 
 void FloatLiteralAST::consume(CstType type) {
-    std::regex r("float(16|32|64|128)");
-    bool       expected_float = std::regex_match(type, r);
-    if (expected_float) {
-        int bits   = std::stoi(type.substr(5, type.size()));
+    string name = type.toString();
+    int    bits = 0;
+    for (int size : {16, 32, 64, 128}) {
+        if (name.starts_with("float") and name.substr(5) == to_string(size)) { bits = size; }
+    }
+    if (bits != 0) {
         this->bits = bits;
     } else if (type != "@unknown"_c) {
         parser::error(parser::errors["Type mismatch"],
@@ -236,7 +245,7 @@ sptr<AST> CharLiteralAST::parse(lexer::TokenStream tokens, int, symbol::Namespac
     DEBUG(4, "Trying \e[1mCharLiteralAST::parse\e[0m");
     if (tokens.size() != 1) { return nullptr; }
     if (tokens[0].type == lexer::Token::Type::CHAR) {
-        if (tokens[0].value.size() == 2) {
+        if (tokens[0].length == 2) {
             parser::error(parser::errors["Empty char"],
                           tokens,
                           "This char value is empty. This is not supported. Did you mean '\\u0000' ?");
@@ -244,10 +253,10 @@ sptr<AST> CharLiteralAST::parse(lexer::TokenStream tokens, int, symbol::Namespac
         }
         std::regex r("'\\\\u[0-9a-fA-F][0-9a-fA-F][0-9a-fA-F][0-9a-fA-F]'");
         std::regex r2("'\\\\(n|a|r|t|f|v|\\\\|'|\"|)'");
-        if (std::regex_match(tokens[0].value, r) || std::regex_match(tokens[0].value, r2) ||
-            tokens[0].value.size() == 3) {
+        if (std::regex_match(string(tokens[0].value()), r) || std::regex_match(string(tokens[0].value()), r2) ||
+            tokens[0].length == 3) {
             // std::cout<<"skdskdl"<<std::endl;
-            return sptr<AST>(new CharLiteralAST(tokens[0].value, tokens));
+            return sptr<AST>(new CharLiteralAST(string(tokens[0].value()), tokens));
         }
         parser::error(parser::errors["Invalid char"],
                       tokens,
@@ -312,7 +321,7 @@ sptr<AST> StringLiteralAST::parse(lexer::TokenStream tokens, int, symbol::Namesp
     DEBUG(4, "Trying StringLiteralAST::parse");
     if (tokens.size() != 1) { return nullptr; }
     if (tokens[0].type == lexer::Token::Type::STRING) {
-        return sptr<AST>(new StringLiteralAST(tokens[0].value, tokens));
+        return sptr<AST>(new StringLiteralAST(string(tokens[0].value()), tokens));
     }
     return nullptr;
 }
@@ -37,14 +37,15 @@ class LiteralAST : public AST {
 };
 
 class IntLiteralAST : public LiteralAST {
-        int  bits    = 32;   //> Integer Bit size
-        bool tsigned = true; //> whether this integer is signed
+        int                   bits    = 32;   //> Integer Bit size
+        bool                  tsigned = true; //> whether this integer is signed
+        lexer::NumericLiteral value   = {};   //> magnitude of this integer, as decoded by the lexer
 
     protected:
         string _str() const { return "<Int: "_s + const_value.value() + " | " + to_string(bits) + ">"; }
 
     public:
-        IntLiteralAST(int bits, string const_value, bool tsigned, lexer::TokenStream tokens);
+        IntLiteralAST(int bits, lexer::NumericLiteral value, bool tsigned, lexer::TokenStream tokens);
 
         virtual ~IntLiteralAST() {}
 
@@ -0,0 +1,471 @@
+#include "interface.hpp"
+
+#include "../helpers/string_functions.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+symbol::InterfaceCache symbol::interface_cache;
+
+// layout: Header, DependencyRecord[dependency_count], ImportRecord[import_count], SymbolRecord[symbol_count],
+// StringRecord[parameter_count], strings. Symbols are stored in pre-order, a namespace is followed by its children
+namespace {
+    struct Header {
+            char   magic[8];
+            uint32 version;
+            uint32 dependency_count;
+            uint32 import_count;
+            uint32 symbol_count;
+            uint32 parameter_count;
+            uint32 reserved;
+            uint64 strings_size;
+    };
+
+    struct StringRecord {
+            uint32 offset; ///< offset in strings
+            uint32 length;
+    };
+
+    struct DependencyRecord {
+            int64        mtime; ///< nanoseconds
+            uint64       size;
+            StringRecord path;
+    };
+
+    struct ImportRecord {
+            StringRecord name;
+            StringRecord alias;
+    };
+
+    enum Kind : uint32 {
+        NAMESPACE,
+        FUNCTION,
+        STRUCT,
+        ENUM,
+        VARIABLE,
+    };
+
+    struct SymbolRecord {
+            uint32       kind;
+            uint32       flags;
+            StringRecord key;   ///< key in the contents of the parent
+            StringRecord name;  ///< location relative to the parent
+            StringRecord type;  ///< return type of functions, type of variables
+            StringRecord value; ///< constant value of variables
+            uint32       parameter_begin;
+            uint32       parameter_count;
+            uint32       child_count; ///< symbols directly contained, they follow this one
+            uint32       reserved;
+    };
+
+    // flags of a symbol, function visibility is stored above visibility_shift
+    constexpr uint32 const_flag        = 1;
+    constexpr uint32 mutable_flag      = 2;
+    constexpr uint32 static_flag       = 4;
+    constexpr uint32 const_value_flag  = 8;
+    constexpr uint32 method_flag       = 1;
+    constexpr uint32 lvalue_flag       = 2;
+    constexpr uint32 stringify_flag    = 1;
+    constexpr uint32 from_string_flag  = 2;
+    constexpr uint32 visibility_shift  = 8;
+
+    constexpr char interface_magic[8] = {'C', 'S', 'T', 'H', 'S', 'T', 'I', '\0'};
+
+    ///
+    /// \brief the symbols of a namespace as records
+    ///
+    struct Encoding {
+            vector<SymbolRecord> symbols    = {};
+            vector<StringRecord> parameters = {};
+            string               strings    = "";
+
+            StringRecord text(const string& s) {
+                StringRecord record  = {(uint32) strings.size(), (uint32) s.size()};
+                strings             += s;
+                return record;
+            }
+
+            /// \brief add a symbol and the symbols it contains in pre-order
+            ///
+            /// \return false if the symbol is not part of an interface
+            bool add(const string& key, symbol::Reference* symbol);
+    };
+
+    bool Encoding::add(const string& key, symbol::Reference* symbol) {
+        using namespace symbol;
+        SymbolRecord record    = {};
+        Namespace*   scope     = nullptr;
+        string       type      = "";
+        string       value     = "";
+        string       kind_name = symbol->getName();
+        if (kind_name == "Namespace") {
+            record.kind = NAMESPACE;
+            scope       = (Namespace*) symbol;
+        } else if (kind_name == "Struct") {
+            record.kind = STRUCT;
+            scope       = (Namespace*) symbol;
+        } else if (kind_name == "Enumeration") {
+            Enum* e      = (Enum*) symbol;
+            record.kind  = ENUM;
+            record.flags = (e->needs_stringify ? stringify_flag : 0) | (e->needs_from_string ? from_string_flag : 0);
+            scope        = e;
+        } else if (kind_name == "Function") { // locals of a function are not part of the interface
+            Function* f            = (Function*) symbol;
+            record.kind            = FUNCTION;
+            record.flags           = (f->is_method ? method_flag : 0) | (f->is_lvalue ? lvalue_flag : 0) |
+                           (uint32) f->visibility << visibility_shift;
+            type                   = f->getReturnType();
+            record.parameter_begin = parameters.size();
+            record.parameter_count = f->parameters.size();
+            for (const CstType& parameter : f->parameters) { parameters.push_back(text(parameter)); }
+        } else if (kind_name == "Variable") {
+            Variable* v  = (Variable*) symbol;
+            record.kind  = VARIABLE;
+            record.flags = (v->is_const ? const_flag : 0) | (v->is_mutable ? mutable_flag : 0) |
+                           (v->is_static ? static_flag : 0) | (v->const_value ? const_value_flag : 0);
+            type         = v->getCstType();
+            value        = v->const_value.value_or("");
+        } else { // imported modules are fetched again instead
+            return false;
+        }
+        record.key   = text(key);
+        record.name  = text(symbol->getRelLoc());
+        record.type  = text(type);
+        record.value = text(value);
+
+        // the child count is patched in once the children are added
+        usize index = symbols.size();
+        symbols.push_back(record);
+        if (scope != nullptr) {
+            uint32 children = 0;
+            for (auto& [child_key, children_at] : scope->contents) {
+                for (Reference* child : children_at) { children += add(child_key, child); }
+            }
+            symbols[index].child_count = children;
+        }
+        return true;
+    }
+
+    /// \brief get the modification time (ns) and size of a file
+    ///
+    /// \return false if the file can not be stat-ed
+    bool statFile(const string& path, int64& mtime, uint64& size) {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) { return false; }
+        mtime = (int64) info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+        size  = info.st_size;
+        return true;
+    }
+} // namespace
+
+void symbol::InterfaceCache::enable(string directory) {
+    error_code error;
+    filesystem::create_directories(directory, error);
+    if (filesystem::is_directory(directory, error)) { this->directory = std::move(directory); }
+}
+
+string symbol::InterfaceCache::entryPath(const string& header) const {
+    error_code error;
+    char       name[32];
+    uint64     key = fnv1a(filesystem::absolute(header, error).string());
+    snprintf(name, sizeof(name), "%016llx.hsti", (unsigned long long) key);
+    return directory + "/" + name;
+}
+
+optional<symbol::InterfaceCache::Interface> symbol::InterfaceCache::load(const string& header_file,
+                                                                         Namespace&    into) {
+    if (not enabled()) { return nullopt; }
+    int fd = open(entryPath(header_file).c_str(), O_RDONLY);
+    if (fd < 0) {
+        miss_count++;
+        return nullopt;
+    }
+    struct stat info;
+    void*       map  = MAP_FAILED;
+    usize       size = 0;
+    if (fstat(fd, &info) == 0 and (usize) info.st_size >= sizeof(Header)) {
+        size = info.st_size;
+        map  = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        miss_count++;
+        return nullopt;
+    }
+
+    vector<Reference*> loaded    = {}; ///< symbols created, deleted again if the interface is broken
+    auto               interface = [&]() -> optional<Interface> {
+        const char*   data   = (const char*) map;
+        const Header* header = (const Header*) data;
+        if (memcmp(header->magic, interface_magic, sizeof(interface_magic)) != 0 or header->version != version or
+            header->dependency_count == 0) {
+            return nullopt;
+        }
+        uint64 expected = sizeof(Header) + (uint64) header->dependency_count * sizeof(DependencyRecord) +
+                          (uint64) header->import_count * sizeof(ImportRecord) +
+                          (uint64) header->symbol_count * sizeof(SymbolRecord) +
+                          (uint64) header->parameter_count * sizeof(StringRecord) + header->strings_size;
+        if (expected != size) { return nullopt; }
+        const DependencyRecord* dependencies = (const DependencyRecord*) (data + sizeof(Header));
+        const ImportRecord*     import_list  = (const ImportRecord*) (dependencies + header->dependency_count);
+        const SymbolRecord*     symbols      = (const SymbolRecord*) (import_list + header->import_count);
+        const StringRecord*     parameters   = (const StringRecord*) (symbols + header->symbol_count);
+        const char*             strings      = (const char*) (parameters + header->parameter_count);
+
+        bool broken = false;
+        auto text   = [&](StringRecord record) -> string {
+            if ((uint64) record.offset + record.length > header->strings_size) {
+                broken = true;
+                return "";
+            }
+            return string(strings + record.offset, record.length);
+        };
+
+        Interface out = {};
+        for (uint32 d = 0; d < header->dependency_count; d++) {
+            int64  mtime = 0;
+            uint64 bytes = 0;
+            string path  = text(dependencies[d].path);
+            if (broken or not statFile(path, mtime, bytes) or mtime != dependencies[d].mtime or
+                bytes != dependencies[d].size) {
+                return nullopt;
+            }
+            if (d > 0) { out.sources.push_back(path); }
+        }
+        for (uint32 i = 0; i < header->import_count; i++) {
+            out.imports.push_back({text(import_list[i].name), text(import_list[i].alias)});
+        }
+
+        // pre-order walk, every open namespace waits for the number of children it has left
+        struct Open {
+                Namespace* ns;
+                uint32     children;
+        };
+        vector<Open> open = {{&into, (uint32) -1}};
+        for (uint32 s = 0; s < header->symbol_count and not broken; s++) {
+            while (open.size() > 1 and open.back().children == 0) { open.pop_back(); }
+            const SymbolRecord& record = symbols[s];
+            if ((uint64) record.parameter_begin + record.parameter_count > header->parameter_count) {
+                return nullopt;
+            }
+            string     name   = text(record.name);
+            Reference* symbol = nullptr;
+            Namespace* scope  = nullptr;
+            switch (record.kind) {
+                case NAMESPACE : symbol = scope = new Namespace(name); break;
+                case STRUCT : symbol = scope = new Struct(name, lexer::TokenStream({})); break;
+                case ENUM : {
+                    Enum* e              = new Enum(name);
+                    e->needs_stringify   = (record.flags & stringify_flag) != 0;
+                    e->needs_from_string = (record.flags & from_string_flag) != 0;
+                    symbol = scope = e;
+                    break;
+                }
+                case FUNCTION : {
+                    Function* f = new Function(nullptr, name, lexer::TokenStream({}), text(record.type));
+                    for (uint32 p = 0; p < record.parameter_count; p++) {
+                        f->parameters.push_back(text(parameters[record.parameter_begin + p]));
+                    }
+                    f->is_method  = (record.flags & method_flag) != 0;
+                    f->is_lvalue  = (record.flags & lvalue_flag) != 0;
+                    f->visibility = Function::Visibility(record.flags >> visibility_shift);
+                    symbol        = f;
+                    break;
+                }
+                case VARIABLE : {
+                    Variable* v   = new Variable(name, text(record.type), lexer::TokenStream({}), nullptr);
+                    v->is_const   = (record.flags & const_flag) != 0;
+                    v->is_mutable = (record.flags & mutable_flag) != 0;
+                    v->is_static  = (record.flags & static_flag) != 0;
+                    if (record.flags & const_value_flag) { v->const_value = text(record.value); }
+                    symbol = v;
+                    break;
+                }
+                default : return nullopt;
+            }
+            loaded.push_back(symbol);
+            if (scope == nullptr and record.child_count > 0) { return nullopt; }
+
+            Namespace* parent  = open.back().ns;
+            symbol->parent     = parent;
+            open.back().children--;
+            parent->contents[text(record.key)].push_back(symbol);
+            if (scope != nullptr and record.child_count > 0) { open.push_back({scope, record.child_count}); }
+        }
+        if (broken) { return nullopt; }
+        for (usize o = 1; o < open.size(); o++) {
+            if (open[o].children != 0) { return nullopt; }
+        }
+        return out;
+    }();
+    munmap(map, size);
+    if (interface) {
+        hit_count++;
+        return interface;
+    }
+    miss_count++;
+    // take back what a broken interface added, the symbols below them are deleted with them
+    set<Reference*> added = {};
+    for (Reference* symbol : loaded) {
+        if (symbol->parent == &into) {
+            added.insert(symbol);
+        } else if (symbol->parent == nullptr) { // created but never added
+            delete symbol;
+        }
+    }
+    for (auto entry = into.contents.begin(); entry != into.contents.end();) {
+        erase_if(entry->second, [&](Reference* symbol) { return added.count(symbol) > 0; });
+        entry = entry->second.empty() ? into.contents.erase(entry) : next(entry);
+    }
+    for (Reference* symbol : added) { delete symbol; }
+    return nullopt;
+}
+
+void symbol::InterfaceCache::store(const string&                 header_file,
+                                   const vector<lexer::Source*>& sources,
+                                   const Namespace&              from,
+                                   const vector<Import>&         imports) {
+    if (not enabled()) { return; }
+    vector<DependencyRecord> dependency_records = {};
+    vector<ImportRecord>     import_records     = {};
+    Encoding                 encoding;
+    for (auto& [key, symbols] : from.contents) {
+        for (Reference* symbol : symbols) { encoding.add(key, symbol); }
+    }
+
+    DependencyRecord header_record = {};
+    if (not statFile(header_file, header_record.mtime, header_record.size)) { return; }
+    header_record.path = encoding.text(header_file);
+    dependency_records.push_back(header_record);
+    for (const lexer::Source* source : sources) {
+        if (source->mtime < 0) { return; } // not read from a file, nothing to check it against
+        dependency_records.push_back({source->mtime, source->text.size(), encoding.text(source->name)});
+    }
+    for (const Import& import : imports) {
+        import_records.push_back({encoding.text(import.name), encoding.text(import.alias)});
+    }
+
+    Header header;
+    memcpy(header.magic, interface_magic, sizeof(interface_magic));
+    header.version          = version;
+    header.dependency_count = dependency_records.size();
+    header.import_count     = import_records.size();
+    header.symbol_count     = encoding.symbols.size();
+    header.parameter_count  = encoding.parameters.size();
+    header.reserved         = 0;
+    header.strings_size     = encoding.strings.size();
+
+    // other compiler processes may map the interface at any time, so it is renamed into place once complete
+    string path      = entryPath(header_file);
+    string temporary =
+        path + "." + to_string(getpid()) + "." + to_string(std::hash<thread::id>()(this_thread::get_id()));
+    FILE*  out       = fopen(temporary.c_str(), "wb");
+    if (out == nullptr) { return; }
+    bool written = fwrite(&header, sizeof(Header), 1, out) == 1;
+    auto write   = [&](auto& records) {
+        using Record = typename remove_reference_t<decltype(records)>::value_type;
+        if (records.empty()) { return; }
+        written = written and fwrite(records.data(), sizeof(Record), records.size(), out) == records.size();
+    };
+    write(dependency_records);
+    write(import_records);
+    write(encoding.symbols);
+    write(encoding.parameters);
+    written = written and fwrite(encoding.strings.data(), 1, encoding.strings.size(), out) == encoding.strings.size();
+    written = fclose(out) == 0 and written;
+    if (not written or rename(temporary.c_str(), path.c_str()) != 0) { unlink(temporary.c_str()); }
+}
+
+uint64 symbol::InterfaceCache::hash(const Namespace& from) {
+    Encoding encoding;
+    for (auto& [key, symbols] : from.contents) {
+        for (Reference* symbol : symbols) { encoding.add(key, symbol); }
+    }
+    string_view symbols((const char*) encoding.symbols.data(), encoding.symbols.size() * sizeof(SymbolRecord));
+    string_view parameters((const char*) encoding.parameters.data(),
+                           encoding.parameters.size() * sizeof(StringRecord));
+    return fnv1a(encoding.strings, fnv1a(parameters, fnv1a(symbols)));
+}
+
+TEST_CASE ("Testing symbol::InterfaceCache", "[symbols]") {
+    filesystem::path dir = filesystem::temp_directory_path() / "cstc_interface_test";
+    filesystem::remove_all(dir);
+    filesystem::create_directories(dir);
+    string header_file = (dir / "shapes.hst").string();
+    string source_file = (dir / "shapes.cst").string();
+    ofstream(header_file) << "header";
+    ofstream(source_file) << "source";
+
+    symbol::Namespace module("shapes");
+    symbol::Function* area = new symbol::Function(nullptr, "area", lexer::TokenStream({}), "f64"_c);
+    area->parameters       = {"Shape"_c, "u8"_c};
+    area->visibility       = symbol::Function::PUBLIC;
+    symbol::Struct* shape  = new symbol::Struct("Shape", lexer::TokenStream({}));
+    shape->add("sides", new symbol::Variable("sides", "u8"_c, lexer::TokenStream({}), nullptr));
+    symbol::Enum* color     = new symbol::Enum("Color");
+    color->needs_stringify  = true;
+    symbol::Namespace* util = new symbol::Namespace("util");
+    symbol::Variable*  pi   = new symbol::Variable("pi", "f64"_c, lexer::TokenStream({}), nullptr);
+    pi->is_const            = true;
+    pi->const_value         = "3.14";
+    util->add("pi", pi);
+    module.add("area", area);
+    module.add("Shape", shape);
+    module.add("Color", color);
+    module.add("util", util);
+
+    symbol::InterfaceCache cache;
+    cache.enable((dir / "cache").string());
+    REQUIRE(not cache.load(header_file, module).has_value());
+    lexer::Source& source = lexer::SourceManager::current().load(source_file);
+    cache.store(header_file, {&source}, module, {{"io", "input"}});
+
+    symbol::Namespace                           loaded("shapes");
+    optional<symbol::InterfaceCache::Interface> interface = cache.load(header_file, loaded);
+    REQUIRE(interface.has_value());
+    REQUIRE(cache.hits() == 1);
+    REQUIRE(interface->imports.size() == 1);
+    REQUIRE(interface->imports[0].name == "io");
+    REQUIRE(interface->imports[0].alias == "input");
+    REQUIRE(interface->sources == vector<string> {source_file});
+    REQUIRE(loaded.contents.size() == 4);
+
+    symbol::Function* f = dynamic_cast<symbol::Function*>(loaded["area"].at(0));
+    REQUIRE(f != nullptr);
+    REQUIRE(f->getCstType() == "[f64<-Shape,u8]"s);
+    REQUIRE(f->visibility == symbol::Function::PUBLIC);
+    REQUIRE(f->parent == &loaded);
+    symbol::Struct* s = dynamic_cast<symbol::Struct*>(loaded["Shape"].at(0));
+    REQUIRE(s != nullptr);
+    REQUIRE(((symbol::Variable*) loaded["Shape::sides"].at(0))->getCstType() == "u8"s);
+    REQUIRE(loaded["Shape::sides"].at(0)->getLoc() == "shapes::Shape::sides");
+    symbol::Enum* e = dynamic_cast<symbol::Enum*>(loaded["Color"].at(0));
+    REQUIRE(e != nullptr);
+    REQUIRE(e->needs_stringify);
+    symbol::Variable* v = dynamic_cast<symbol::Variable*>(loaded["util::pi"].at(0));
+    REQUIRE(v != nullptr);
+    REQUIRE(v->is_const);
+    REQUIRE(v->const_value == "3.14"s);
+
+    // the hash covers the symbols, not where they came from
+    REQUIRE(symbol::InterfaceCache::hash(loaded) == symbol::InterfaceCache::hash(module));
+    pi->const_value = "3.1416";
+    REQUIRE(symbol::InterfaceCache::hash(loaded) != symbol::InterfaceCache::hash(module));
+
+    // a changed source makes the interface out of date
+    ofstream(source_file) << "changed";
+    symbol::Namespace stale("shapes");
+    REQUIRE(not cache.load(header_file, stale).has_value());
+    REQUIRE(stale.contents.empty());
+    REQUIRE(cache.misses() == 2);
+
+    filesystem::remove_all(dir);
+}
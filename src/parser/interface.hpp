@@ -0,0 +1,91 @@
+#pragma once
+
+//
+// INTERFACE.hpp
+//
+// layouts the on-disk cache of precompiled module interfaces
+//
+
+#include "../lexer/source.hpp"
+#include "../snippets.hpp"
+#include "symboltable.hpp"
+
+#include <atomic>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace symbol {
+
+    ///
+    /// \brief stores the exported symbols of header modules on disk, so dependent compilations skip their sources
+    ///
+    /// An interface is the symbol tree of a module (namespaces, functions, structs, enums and variables with their
+    /// CstTypes) and the modules it imports. It lists the files it was built from (the .hst, the .cst and their
+    /// includes) with their modification time and size and is only used if none of them changed. Interfaces are
+    /// written to a temporary file and renamed, and mapped when loaded.
+    ///
+    class InterfaceCache final {
+            string directory = ""; ///< cache directory, empty if the cache is disabled
+
+            atomic<usize> hit_count  = 0;
+            atomic<usize> miss_count = 0;
+
+            /// \brief get the file the interface of a header is stored in
+            string entryPath(const string& header) const;
+
+        public:
+            static constexpr uint32 version = 1; ///< increase whenever the symbol classes or the layout change
+
+            ///
+            /// \brief a module imported by an interface
+            ///
+            struct Import {
+                    string name;  ///< module name as written in the import statement
+                    string alias; ///< name the module is added as
+            };
+
+            ///
+            /// \brief what an interface tells besides its symbols
+            ///
+            struct Interface {
+                    vector<Import> imports; ///< modules to fetch
+                    vector<string> sources; ///< files the symbols were read from, without the header
+            };
+
+            /// \brief use a directory (created if needed) for the cache
+            void enable(string directory);
+
+            /// \brief check if interfaces are loaded and stored
+            bool enabled() const { return not directory.empty(); }
+
+            /// \brief load the interface of a header, its symbols are added to a namespace
+            ///
+            /// \return the imports and sources of the interface, nullopt if there is none or it is out of date
+            optional<Interface> load(const string& header, Namespace& into);
+
+            /// \brief store the interface of a header
+            ///
+            /// \param sources the sources the symbols were read from, the header is added to them
+            /// \param from    namespace holding the exported symbols, contained modules are not stored
+            /// \param imports modules to fetch again when the interface is loaded
+            void store(const string&                 header,
+                       const vector<lexer::Source*>& sources,
+                       const Namespace&              from,
+                       const vector<Import>&         imports);
+
+            /// \brief hash the symbols of a namespace as they would be stored in an interface
+            static uint64 hash(const Namespace& from);
+
+            /// \brief get the number of interfaces loaded
+            usize hits() const { return hit_count; }
+
+            /// \brief get the number of interfaces that were missing or out of date
+            usize misses() const { return miss_count; }
+    };
+
+    extern InterfaceCache interface_cache; ///< interface cache of all sessions, disabled by default
+
+} // namespace symbol
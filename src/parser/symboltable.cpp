@@ -112,7 +112,7 @@ void symbol::Namespace::LinearitySnapshot::traceback(LinearitySnapshot ls) const
 }
 
 symbol::Function::Function(symbol::Reference* parent, string name, lexer::TokenStream tokens, CstType type) {
-    this->tokens = tokens.tokens;
+    this->tokens = tokens;
     this->loc    = name;
     this->parent = parent;
     this->type   = type;
@@ -259,7 +259,7 @@ namespace symbol {
 
             CstType getReturnType() const { return type; }
 
-            virtual ~Function() { Namespace::~Namespace(); };
+            virtual ~Function() = default;
 
             virtual usize sizeBytes() { return 8; }
 
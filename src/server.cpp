@@ -0,0 +1,389 @@
+
+//
+// SERVER.cpp
+//
+// implements the resident compiler and its client
+//
+
+#include "server.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <poll.h>
+#include <sstream>
+#include <streambuf>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+// a request is a list of strings: uint32 count, then uint32 length and bytes per string.
+// An answer is a list of frames: uint8 channel, uint32 length and bytes, the last frame holds the exit code
+namespace {
+    enum Channel : uint8 {
+        EXIT_CODE = 0,
+        OUT       = 1,
+        ERR       = 2,
+    };
+
+    constexpr uint32 max_frame = 64 << 20; ///< larger frames are not trusted
+
+    constexpr chrono::milliseconds request_timeout = 2s; ///< time a client has to send its whole request
+
+    volatile sig_atomic_t stopping = 0; ///< set by SIGINT and SIGTERM while serving
+
+    bool writeAll(int fd, const char* data, usize size) {
+        while (size > 0) {
+            ssize_t written = write(fd, data, size);
+            if (written < 0 and errno == EINTR) { continue; }
+            if (written <= 0) { return false; }
+            data += written;
+            size -= written;
+        }
+        return true;
+    }
+
+    bool readAll(int fd, char* data, usize size) {
+        while (size > 0) {
+            ssize_t got = read(fd, data, size);
+            if (got < 0 and errno == EINTR) { continue; }
+            if (got <= 0) { return false; }
+            data += got;
+            size -= got;
+        }
+        return true;
+    }
+
+    /// \brief read a part of a request. The daemon answers one client at a time, so it gives up on a client that is
+    /// too slow and whenever it is stopped
+    bool readRequest(int fd, char* data, usize size, chrono::steady_clock::time_point deadline) {
+        while (size > 0) {
+            auto left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now());
+            if (stopping or left <= 0ms) { return false; }
+            pollfd readable = {fd, POLLIN, 0};
+            int    ready    = poll(&readable, 1, (int) min(left, 200ms).count());
+            if (ready < 0 and errno != EINTR) { return false; }
+            if (ready <= 0) { continue; }
+            ssize_t got = read(fd, data, size);
+            if (got < 0 and errno == EINTR) { continue; }
+            if (got <= 0) { return false; }
+            data += got;
+            size -= got;
+        }
+        return true;
+    }
+
+    bool sendFrame(int fd, uint8 channel, string_view data) {
+        char   header[5] = {(char) channel};
+        uint32 size      = data.size();
+        memcpy(header + 1, &size, sizeof(size));
+        return writeAll(fd, header, sizeof(header)) and writeAll(fd, data.data(), data.size());
+    }
+
+    optional<pair<uint8, string>> receiveFrame(int fd) {
+        char   header[5];
+        uint32 size = 0;
+        if (not readAll(fd, header, sizeof(header))) { return nullopt; }
+        memcpy(&size, header + 1, sizeof(size));
+        if (size > max_frame) { return nullopt; }
+        string data(size, '\0');
+        if (not readAll(fd, data.data(), size)) { return nullopt; }
+        return pair<uint8, string> {(uint8) header[0], std::move(data)};
+    }
+
+    bool sendRequest(int fd, const vector<string>& strings) {
+        uint32 count = strings.size();
+        if (not writeAll(fd, (const char*) &count, sizeof(count))) { return false; }
+        for (const string& s : strings) {
+            uint32 size = s.size();
+            if (not writeAll(fd, (const char*) &size, sizeof(size)) or not writeAll(fd, s.data(), s.size())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    optional<vector<string>> receiveRequest(int fd) {
+        auto   deadline = chrono::steady_clock::now() + request_timeout;
+        uint32 count    = 0;
+        if (not readRequest(fd, (char*) &count, sizeof(count), deadline) or count > 4096) { return nullopt; }
+        vector<string> strings = {};
+        for (uint32 i = 0; i < count; i++) {
+            uint32 size = 0;
+            if (not readRequest(fd, (char*) &size, sizeof(size), deadline) or size > max_frame) { return nullopt; }
+            string s(size, '\0');
+            if (not readRequest(fd, s.data(), size, deadline)) { return nullopt; }
+            strings.push_back(std::move(s));
+        }
+        return strings;
+    }
+
+    ///
+    /// \brief sends what is written to a stream to a client, as frames of one channel
+    ///
+    /// Worker threads print while a request is handled, the buffers of a client share a lock so frames of
+    /// its channels never interleave.
+    ///
+    class ClientBuffer final : public streambuf {
+            int    fd;
+            uint8  channel;
+            mutex& lock;
+            string buffer = "";
+
+            void send() { // with lock held
+                if (not buffer.empty()) { sendFrame(fd, channel, buffer); }
+                buffer.clear();
+            }
+
+        protected:
+            int overflow(int c) override {
+                if (c == traits_type::eof()) { return traits_type::not_eof(c); }
+                lock_guard<mutex> guard(lock);
+                buffer.push_back((char) c);
+                if (buffer.size() >= 4096) { send(); }
+                return c;
+            }
+
+            streamsize xsputn(const char* data, streamsize size) override {
+                lock_guard<mutex> guard(lock);
+                buffer.append(data, size);
+                if (buffer.size() >= 4096) { send(); }
+                return size;
+            }
+
+            int sync() override {
+                lock_guard<mutex> guard(lock);
+                send();
+                return 0;
+            }
+
+        public:
+            ClientBuffer(int fd, uint8 channel, mutex& lock) : fd(fd), channel(channel), lock(lock) {}
+    };
+
+    /// \brief fill the address of a socket file
+    ///
+    /// \return false if the path is too long for a Unix socket
+    bool socketAddress(const string& socket_path, sockaddr_un& address) {
+        address            = {};
+        address.sun_family = AF_UNIX;
+        if (socket_path.size() >= sizeof(address.sun_path)) { return false; }
+        memcpy(address.sun_path, socket_path.data(), socket_path.size());
+        return true;
+    }
+
+    /// \brief connect to the socket of a daemon
+    ///
+    /// \return the connection, -1 if no daemon listens on it
+    int connectTo(const string& socket_path) {
+        sockaddr_un address;
+        if (not socketAddress(socket_path, address)) { return -1; }
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) { return -1; }
+        if (connect(fd, (sockaddr*) &address, sizeof(address)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+} // namespace
+
+server::Watcher::Watcher() : fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {}
+
+server::Watcher::~Watcher() {
+    if (fd >= 0) { close(fd); }
+}
+
+void server::Watcher::watch(const string& directory) {
+    if (fd < 0 or watched.count(directory) > 0) { return; }
+    int wd = inotify_add_watch(fd,
+                               directory.c_str(),
+                               IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                                   IN_MOVED_TO);
+    if (wd < 0) { return; }
+    directories[wd] = directory;
+    watched.insert(directory);
+}
+
+optional<set<string>> server::Watcher::changes() {
+    if (fd < 0) { return nullopt; } // nothing is watched, anything may have changed
+    set<string> out  = {};
+    bool        lost = false;
+    alignas(inotify_event) char buffer[4096];
+    for (ssize_t size; (size = read(fd, buffer, sizeof(buffer))) > 0;) {
+        for (char* p = buffer; p < buffer + size;) {
+            inotify_event* event  = (inotify_event*) p;
+            p                    += sizeof(inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) { lost = true; }
+            auto directory = directories.find(event->wd);
+            if (directory == directories.end()) { continue; }
+            if (event->mask & IN_IGNORED) { // the directory is gone
+                watched.erase(directory->second);
+                directories.erase(directory);
+                continue;
+            }
+            if (event->len > 0) { out.insert(directory->second + "/" + event->name); }
+        }
+    }
+    if (lost) { return nullopt; }
+    return out;
+}
+
+int32 server::serve(const string& socket_path, Handler handler) {
+    sockaddr_un address;
+    if (not socketAddress(socket_path, address)) {
+        cerr << "\e[1;31mERROR:\e[0m socket path \e[1m" << socket_path << "\e[0m is too long" << endl;
+        return EXIT_FAILURE;
+    }
+    if (int other = connectTo(socket_path); other >= 0) {
+        close(other);
+        cerr << "\e[1;31mERROR:\e[0m a daemon is already listening on \e[1m" << socket_path << "\e[0m" << endl;
+        return EXIT_FAILURE;
+    }
+    unlink(socket_path.c_str()); // left over from a daemon that did not stop cleanly
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0 or bind(listener, (sockaddr*) &address, sizeof(address)) != 0 or listen(listener, 16) != 0) {
+        cerr << "\e[1;31mERROR:\e[0m could not listen on \e[1m" << socket_path << "\e[0m: " << strerror(errno)
+             << endl;
+        if (listener >= 0) { close(listener); }
+        return EXIT_FAILURE;
+    }
+
+    struct sigaction stop     = {};
+    struct sigaction old_int  = {};
+    struct sigaction old_term = {};
+    struct sigaction old_pipe = {};
+    stop.sa_handler           = [](int) { stopping = 1; };
+    sigaction(SIGINT, &stop, &old_int);
+    sigaction(SIGTERM, &stop, &old_term);
+    stop.sa_handler = SIG_IGN; // a client that went away must not take the daemon with it
+    sigaction(SIGPIPE, &stop, &old_pipe);
+    stopping = 0;
+
+    string directory = filesystem::current_path().string();
+    while (not stopping) {
+        pollfd waiting = {listener, POLLIN, 0};
+        if (poll(&waiting, 1, 200) <= 0) { continue; }
+        int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) { continue; }
+
+        optional<vector<string>> request = receiveRequest(client);
+        if (request and not request->empty()) {
+            int32 code = EXIT_FAILURE;
+            if (request->front() != directory) { // relative paths of the client would mean something else here
+                sendFrame(client, ERR, "\e[1;31mERROR:\e[0m the daemon serves " + directory + "\n");
+            } else {
+                mutex        lock;
+                ClientBuffer out(client, OUT, lock);
+                ClientBuffer err(client, ERR, lock);
+                streambuf*   old_out = cout.rdbuf(&out);
+                streambuf*   old_err = cerr.rdbuf(&err);
+                try {
+                    code = handler(vector<string>(request->begin() + 1, request->end()));
+                } catch (const exception& e) {
+                    cerr << "\e[1;31mERROR:\e[0m internal compiler error: " << e.what() << endl;
+                }
+                cout.flush();
+                cerr.flush();
+                cout.rdbuf(old_out);
+                cerr.rdbuf(old_err);
+            }
+            sendFrame(client, EXIT_CODE, string_view((const char*) &code, sizeof(code)));
+        }
+        close(client);
+    }
+
+    close(listener);
+    unlink(socket_path.c_str());
+    sigaction(SIGINT, &old_int, nullptr);
+    sigaction(SIGTERM, &old_term, nullptr);
+    sigaction(SIGPIPE, &old_pipe, nullptr);
+    return EXIT_SUCCESS;
+}
+
+optional<int32> server::forward(const string& socket_path, const vector<string>& args, ostream& out, ostream& err) {
+    int fd = connectTo(socket_path);
+    if (fd < 0) { return nullopt; }
+    vector<string> request = {filesystem::current_path().string()};
+    request.insert(request.end(), args.begin(), args.end());
+    if (not sendRequest(fd, request)) {
+        close(fd);
+        return nullopt;
+    }
+    while (optional<pair<uint8, string>> frame = receiveFrame(fd)) {
+        auto& [channel, data] = *frame;
+        if (channel == EXIT_CODE and data.size() == sizeof(int32)) {
+            int32 code;
+            memcpy(&code, data.data(), sizeof(code));
+            close(fd);
+            out.flush();
+            return code;
+        }
+        (channel == ERR ? err : out).write(data.data(), data.size());
+    }
+    close(fd);
+    err << "\e[1;31mERROR:\e[0m the daemon on \e[1m" << socket_path << "\e[0m stopped answering" << endl;
+    return EXIT_FAILURE;
+}
+
+TEST_CASE ("Testing server::Watcher", "[server]") {
+    filesystem::path dir = filesystem::temp_directory_path() / "cstc_watcher_test";
+    filesystem::remove_all(dir);
+    filesystem::create_directories(dir);
+    ofstream(dir / "a.cst") << "a";
+
+    server::Watcher watcher;
+    watcher.watch(dir.string());
+    REQUIRE(watcher.changes()->empty());
+    ofstream(dir / "a.cst") << "changed";
+    ofstream(dir / "b.cst") << "new";
+    filesystem::remove(dir / "a.cst");
+    REQUIRE((watcher.changes() == set<string> {(dir / "a.cst").string(), (dir / "b.cst").string()}));
+    REQUIRE(watcher.changes()->empty());
+
+    filesystem::remove_all(dir);
+}
+
+TEST_CASE ("Testing server::serve", "[server]") {
+    string socket_path = (filesystem::temp_directory_path() / "cstc_server_test.sock").string();
+    REQUIRE(not server::forward(socket_path, {"cstc", "a.cst"}).has_value());
+
+    thread daemon([&]() {
+        server::serve(socket_path, [&](const vector<string>& args) {
+            cout << "compiling " << args.at(1) << endl;
+            cerr << "a warning" << endl;
+            if (args.at(1) == "stop") { raise(SIGTERM); }
+            return 7;
+        });
+    });
+    for (usize i = 0; i < 500 and not filesystem::exists(socket_path); i++) { this_thread::sleep_for(10ms); }
+
+    stringstream out;
+    stringstream err;
+    REQUIRE(server::forward(socket_path, {"cstc", "a.cst"}, out, err) == 7);
+    REQUIRE(out.str() == "compiling a.cst\n");
+    REQUIRE(err.str() == "a warning\n");
+    // a client that sends nothing holds up the next one only until its request timed out
+    int silent = connectTo(socket_path);
+    REQUIRE(server::forward(socket_path, {"cstc", "b.cst"}, out, err) == 7);
+    close(silent);
+    REQUIRE(server::forward(socket_path, {"cstc", "stop"}, out, err) == 7);
+    daemon.join();
+    REQUIRE(not filesystem::exists(socket_path));
+
+    // nor does it keep the daemon from stopping
+    thread waiting([&]() { server::serve(socket_path, [](const vector<string>&) { return 0; }); });
+    for (usize i = 0; i < 500 and not filesystem::exists(socket_path); i++) { this_thread::sleep_for(10ms); }
+    this_thread::sleep_for(100ms); // the signal handlers are set right after the socket is bound
+    silent = connectTo(socket_path);
+    this_thread::sleep_for(100ms);
+    raise(SIGTERM);
+    waiting.join();
+    close(silent);
+    REQUIRE(not filesystem::exists(socket_path));
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+//
+// SERVER.hpp
+//
+// layouts the resident compiler and its client
+//
+
+#include "snippets.hpp"
+
+#include <functional>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+///
+/// \namespace the resident compiler: a daemon that keeps modules loaded and answers compile requests
+///
+/// Requests come in over a Unix socket, one at a time. A request is the working directory and the command-line
+/// arguments of a client, the answer is everything the compilation prints, followed by its exit code.
+///
+namespace server {
+
+    ///
+    /// \brief reports files that changed in watched directories (inotify)
+    ///
+    class Watcher final {
+            int              fd          = -1; ///< inotify instance
+            map<int, string> directories = {}; ///< watch descriptor -> directory
+            set<string>      watched     = {}; ///< directories with a watch
+
+        public:
+            Watcher();
+            Watcher(const Watcher&)            = delete;
+            Watcher& operator=(const Watcher&) = delete;
+            ~Watcher();
+
+            /// \brief watch the files in a directory (not its subdirectories)
+            void watch(const string& directory);
+
+            /// \brief get the files that changed, were created or removed since the last call
+            ///
+            /// \return absolute paths, nullopt if events were lost and any file may have changed
+            optional<set<string>> changes();
+    };
+
+    ///
+    /// \brief handles a compile request
+    ///
+    /// \param args command-line arguments of the client, starting with the program name
+    ///
+    /// \return exit code for the client
+    ///
+    using Handler = function<int32(const vector<string>& args)>;
+
+    /// \brief answer compile requests until the process gets SIGINT or SIGTERM
+    ///
+    /// std::cout and std::cerr are sent to the client while its request is handled. A client that does not send its
+    /// whole request within two seconds is dropped.
+    ///
+    /// \return exit code of the daemon, EXIT_FAILURE if the socket could not be opened
+    extern int32 serve(const string& socket_path, Handler handler);
+
+    /// \brief send a compile request to a daemon and print its answer
+    ///
+    /// \param args command-line arguments, starting with the program name
+    /// \param out  stream for what the compilation prints to std::cout
+    /// \param err  stream for what the compilation prints to std::cerr
+    ///
+    /// \return the exit code of the compilation, nullopt if there is no daemon
+    extern optional<int32> forward(const string&         socket_path,
+                                   const vector<string>& args,
+                                   ostream&              out = cout,
+                                   ostream&              err = cerr);
+
+} // namespace server
@@ -0,0 +1,127 @@
+//
+// SESSION.cpp
+//
+// implements the state of a single compilation
+//
+
+#include "session.hpp"
+
+#include "helpers/stat_cache.hpp"
+#include "helpers/thread_pool.hpp"
+#include "module.hpp"
+
+#include <fstream>
+#include <thread>
+
+namespace {
+
+    thread_local CompilationSession* bound = nullptr; ///< session the current thread works for
+
+} // namespace
+
+CompilationSession::CompilationSession(const CompilationSession* shared) : shared(shared) {
+    if (shared != nullptr) { std_index = shared->std_index; }
+}
+
+CompilationSession::~CompilationSession() {
+    Scope scope(*this);
+    Module::clear();
+}
+
+Module* CompilationSession::sharedModule(const string& name) const {
+    if (shared == nullptr) { return nullptr; }
+    auto module = shared->known_modules.find(name);
+    return module == shared->known_modules.end() ? shared->sharedModule(name) : module->second;
+}
+
+void CompilationSession::submit(function<void()> job) {
+    {
+        lock_guard<mutex> guard(jobs_lock);
+        pending++;
+    }
+    ThreadPool::shared().submit([this, job = std::move(job)]() {
+        {
+            Scope scope(*this);
+            job();
+        }
+        lock_guard<mutex> guard(jobs_lock);
+        if (--pending == 0) { jobs_done.notify_all(); }
+    });
+}
+
+void CompilationSession::wait() {
+    unique_lock<mutex> guard(jobs_lock);
+    jobs_done.wait(guard, [this]() { return pending == 0; });
+}
+
+void CompilationSession::parallelFor(usize count, function<void(usize)> body) {
+    ThreadPool::shared().parallelFor(count, [this, &body](usize i) {
+        Scope scope(*this);
+        body(i);
+    });
+}
+
+CompilationSession& CompilationSession::current() {
+    // never destroyed, its modules may still be in use while the process exits
+    static CompilationSession* process = new CompilationSession();
+    return bound != nullptr ? *bound : *process;
+}
+
+CompilationSession::Scope::Scope(CompilationSession& session) : previous(bound) {
+    bound = &session;
+}
+
+CompilationSession::Scope::~Scope() {
+    bound = previous;
+}
+
+TEST_CASE ("Testing CompilationSession", "[modules]") {
+    fs::path dir = fs::temp_directory_path() / "cstc_session_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    ofstream(dir / "shared.cst") << "x = 1;\n";
+    ofstream(dir / "good.cst") << "import shared;\n";
+    ofstream(dir / "bad.cst") << "import shared;\ninclude \"missing.cst\"\n";
+    stat_cache.clear();
+
+    // preload a module once, like lang
+    CompilationSession base;
+    Module*            preloaded = nullptr;
+    {
+        CompilationSession::Scope scope(base);
+        preloaded = Module::create("shared", "", (dir / "main.cst").string(), false, lexer::TokenStream::none(), true);
+        Module::awaitFetched();
+        for (vector<Module*>& level : Module::buildLevels()) {
+            for (Module* m : level) { m->parse(); }
+        }
+    }
+
+    auto compile = [&](CompilationSession& session, string name) {
+        CompilationSession::Scope scope(session);
+        session.muted = true;
+        Module::create(name, "", (dir / "main.cst").string(), false, lexer::TokenStream::none(), true);
+        Module::awaitFetched();
+        for (vector<Module*>& level : Module::buildLevels()) {
+            session.parallelFor(level.size(), [&](usize i) { level[i]->parse(); });
+        }
+    };
+    CompilationSession good(&base);
+    CompilationSession bad(&base);
+    thread             other([&]() { compile(bad, "bad"); });
+    compile(good, "good");
+    other.join();
+
+    // diagnostics are counted where they were issued
+    REQUIRE(good.errc == 0);
+    REQUIRE(bad.errc == 1);
+    REQUIRE(base.errc == 0);
+
+    // the preloaded module is imported as it is, not loaded again
+    REQUIRE(good.known_modules.size() == 1);
+    REQUIRE(bad.known_modules.size() == 1);
+    REQUIRE(good.modules.size() == 1);
+    REQUIRE(good.modules.front()->getLocal("shared") == vector<symbol::Reference*> {preloaded});
+    REQUIRE(bad.modules.front()->getLocal("shared") == vector<symbol::Reference*> {preloaded});
+
+    fs::remove_all(dir);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+//
+// SESSION.hpp
+//
+// layouts the state of a single compilation
+//
+
+#include "lexer/source.hpp"
+#include "snippets.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+
+using namespace std;
+
+class Module;
+class StdIndex;
+
+///
+/// \brief everything a compilation finds and counts: its modules, its diagnostics and its settings
+///
+/// Compilations in different sessions are independent, so several programs can be compiled at once in one process.
+/// A thread works for one session at a time (\see Scope), diagnostics are counted in the session of the thread
+/// issuing them. Module::create(), awaitFetched(), buildLevels(), refresh() and clear() work on the current session.
+///
+/// A session can use the modules of a shared session instead of loading them again, e.g. a preloaded lang module.
+/// Shared modules are never changed, the shared session must not compile anymore while it is shared.
+///
+/// What does not depend on the program stays process-wide: stat_cache, the on-disk token_cache and interface_cache,
+/// the lexer tunables and stdLibRoot(). The caches are locked or only use atomics, and every cache entry is checked
+/// against the files it was made from. The tunables and the cache directory are set before the first session
+/// starts, and CSTC_STD does not change while the process runs.
+///
+class CompilationSession final {
+        const CompilationSession* shared = nullptr; ///< session whose modules are used as they are
+
+        usize              pending = 0; ///< submitted jobs that did not finish yet
+        mutex              jobs_lock;
+        condition_variable jobs_done;
+
+    public:
+        map<string, Module*> known_modules   = {}; ///< modules of this session by name, to reuse them when imported
+        list<string>         unknown_modules = {}; ///< imported modules that were not found, for the module list
+        list<Module*>        modules         = {}; ///< modules of this session in build order, set by awaitFetched()
+        mutex                modules_lock;         ///< guards known_modules and unknown_modules while fetching
+        filesystem::path     directory       = {}; ///< program directory, set before fetching, for diagnostics
+        lexer::SourceManager source_manager;       ///< sources and tokens of the modules, freed with them
+        sptr<const StdIndex> std_index = nullptr;  ///< index of the stdlib, loaded on first use or from the shared one
+        mutex                std_index_lock;
+
+        atomic<usize> parsed_modules = 0; ///< modules parsed, for the progress line
+        mutex         progress_lock;      ///< held while printing the progress line
+
+        uint64       errc        = 0;     ///< amount of raised errors
+        uint64       warnc       = 0;     ///< amount of raised warnings
+        bool         one_error   = false; ///< stop the compilation on the first error
+        atomic<bool> stopped     = false; ///< the first error was raised with one_error, later diagnostics are dropped
+        bool         muted       = false; ///< do not print diagnostics, they are still counted
+        int32        pretty_size = 120;   ///< max line length before a "Line too long" warning, -1 to disable
+
+        /// \brief start an empty session
+        ///
+        /// \param shared session whose modules are used instead of loading them again, it has to outlive this one
+        explicit CompilationSession(const CompilationSession* shared = nullptr);
+        CompilationSession(const CompilationSession&)            = delete;
+        CompilationSession& operator=(const CompilationSession&) = delete;
+
+        /// \brief wait for the jobs of this session and delete its modules
+        ~CompilationSession();
+
+        /// \brief get a module of the shared session
+        ///
+        /// \return nullptr if there is no shared session or it has no such module
+        Module* sharedModule(const string& name) const;
+
+        /// \brief run a job on the shared ThreadPool, working for this session
+        void submit(function<void()> job);
+
+        /// \brief block until every job submitted to this session finished, including the jobs they submitted
+        ///
+        /// Like ThreadPool::wait(), this must not be called from a job.
+        void wait();
+
+        /// \brief ThreadPool::parallelFor() working for this session
+        void parallelFor(usize count, function<void(usize)> body);
+
+        /// \brief get the session the calling thread works for, a process-wide session if it works for none
+        static CompilationSession& current();
+
+        ///
+        /// \brief makes the calling thread work for a session while it exists
+        ///
+        class Scope final {
+                CompilationSession* previous;
+
+            public:
+                explicit Scope(CompilationSession& session);
+                Scope(const Scope&)            = delete;
+                Scope& operator=(const Scope&) = delete;
+                ~Scope();
+        };
+};
@@ -38,11 +38,13 @@ typedef __UINT8_TYPE__ uint8;
 typedef __U16_TYPE     uint16;
 typedef __U32_TYPE     uint32;
 typedef __U64_TYPE     uint64;
+typedef unsigned __int128 uint128;
 
 typedef __INT8_TYPE__ int8;
 typedef __S16_TYPE    int16;
 typedef __S32_TYPE    int32;
 typedef __S64_TYPE    int64;
+typedef __int128      int128;
 
 typedef __SSIZE_T_TYPE          ssize;
 typedef unsigned __SSIZE_T_TYPE usize;
@@ -69,12 +71,13 @@ inline std::string operator""_s(const char* c, usize) {
 
     // define all needed macros to be unused functions
     #define TEST_CASE(a, b)                                                                               \
-        [[maybe_unused]] void CONCAT(_test_case_, CONCAT(__COUNTER__, CONCAT(_, __LINE__)))(const char* _a = a, \
+        [[maybe_unused]] static void CONCAT(_test_case_, CONCAT(__COUNTER__, CONCAT(_, __LINE__)))(const char* _a = a, \
                                                                                       const char* _b = b)
     #define TEMPLATE_TEST_CASE(a, b, ...)                                                                      \
         [[maybe_unused]] CONCAT(_test_case_,                                                                         \
                           CONCAT(__COUNTER__, CONCAT(_, __LINE__)))(const char* a, const char* b, __VA_ARGS__)
     #define REQUIRE(a) if(a){}
+    #define WARN(a)
     #define BENCHMARK(a)
     #define SECTION(a) if(a)
     #define GENERATE(a, ...) a
@@ -85,6 +88,10 @@ inline std::string operator""_s(const char* c, usize) {
     #define main [[maybe_unused]] _no_main_
     #if (CATCH2_VERSION < 3)
         #include <catch2/catch.hpp>
+        #ifndef BENCHMARK
+            // catch2 v2 only provides benchmarks if built with CATCH_CONFIG_ENABLE_BENCHMARKING
+            #define BENCHMARK(a) [&]()
+        #endif
     #else
         #include <catch2/catch_all.hpp>
     #endif